@@ -0,0 +1,100 @@
+#include "Batch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+bool Batch::read(std::istream & in, std::vector<BatchJob> & jobs)
+{
+    jobs.clear();
+    std::string shared;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        std::istringstream words(line);
+        std::string head;
+        if (!(words >> head))
+        {
+            continue;
+        }
+
+        if (head == "Job")
+        {
+            BatchJob job;
+            words >> job.seed >> job.ticks;
+            job.config = shared;
+            jobs.push_back(job);
+        } else
+        {
+            // Later lines override earlier ones with the same head, since
+            // Game reads them in order
+            std::string& config = jobs.empty() ? shared : jobs.back().config;
+            config += line;
+            config += '\n';
+        }
+    }
+    return !jobs.empty();
+}
+
+void Batch::run(const std::vector<BatchJob> & jobs, ThreadPool & pool, std::vector<BatchResult> & results)
+{
+    results.assign(jobs.size(), BatchResult());
+    pool.forEach(jobs.size(), [&](size_t i)
+    {
+        const BatchJob& job = jobs[i];
+        std::istringstream config(job.config);
+        Game game(config, 1);
+        game.setSeed(job.seed);
+
+        std::vector<float> tickUs(std::max(job.ticks, 0));
+        auto start = std::chrono::steady_clock::now();
+        auto last = start;
+        for (float& us : tickUs)
+        {
+            game.step();
+            auto now = std::chrono::steady_clock::now();
+            us = std::chrono::duration<float, std::micro>(now - last).count();
+            last = now;
+        }
+
+        BatchResult& r = results[i];
+        r.summary = game.summary();
+        r.seconds = std::chrono::duration<double>(last - start).count();
+        if (!tickUs.empty())
+        {
+            r.avgTickUs = r.seconds * 1e6 / tickUs.size();
+            r.maxTickUs = *std::max_element(tickUs.begin(), tickUs.end());
+            auto p99 = tickUs.begin() + (tickUs.size() * 99 + 99) / 100 - 1;
+            std::nth_element(tickUs.begin(), p99, tickUs.end());
+            r.p99TickUs = *p99;
+        }
+    });
+}
+
+void Batch::report(std::ostream & out, const std::vector<BatchJob> & jobs,
+                   const std::vector<BatchResult> & results, double seconds, size_t threads)
+{
+    size_t ticks = 0;
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BatchResult& r = results[i];
+        out << "{\"job\":" << i
+            << ",\"seed\":" << jobs[i].seed
+            << ",\"ticks\":" << r.summary.ticks
+            << ",\"score\":" << r.summary.score
+            << ",\"entities\":" << r.summary.entities
+            << ",\"enemies\":" << r.summary.enemies
+            << ",\"bullets\":" << r.summary.bullets
+            << ",\"avg_tick_us\":" << r.avgTickUs
+            << ",\"p99_tick_us\":" << r.p99TickUs
+            << ",\"max_tick_us\":" << r.maxTickUs
+            << "}\n";
+        ticks += r.summary.ticks;
+    }
+    out << "{\"jobs\":" << results.size()
+        << ",\"threads\":" << threads
+        << ",\"seconds\":" << seconds
+        << ",\"ticks_per_second\":" << (seconds > 0 ? ticks / seconds : 0.0)
+        << "}" << std::endl;
+}
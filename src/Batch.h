@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Game.h"
+#include "ThreadPool.h"
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// Many independent windowless games in one process, e.g. a parameter sweep
+// over config values. Each job builds its own Game from its config text on
+// whichever pool thread picks it up, runs it single-threaded and drops it,
+// so jobs share no simulation state and at most one Game per thread is
+// alive at a time. A game's outcome depends only on its job, so results are
+// the same whatever the pool size; only the timings differ.
+struct BatchJob
+{
+    std::string config;         // the config.txt format
+    unsigned    seed = 1;
+    int         ticks = 3600;
+};
+
+struct BatchResult
+{
+    GameSummary summary;
+    double      seconds = 0;    // stepping only, not building the game
+    double      avgTickUs = 0;
+    double      p99TickUs = 0;
+    double      maxTickUs = 0;
+};
+
+namespace Batch
+{
+    // One job per "Job seed ticks" line, its config the lines up to the next
+    // one. Config lines before the first Job line are shared by every job and
+    // come first, so each job need only list what it changes. False if there
+    // are no jobs.
+    bool read(std::istream & in, std::vector<BatchJob> & jobs);
+
+    // Runs every job on the pool, one job per task; results are in job order
+    void run(const std::vector<BatchJob> & jobs, ThreadPool & pool, std::vector<BatchResult> & results);
+
+    // One JSON object per job, then a totals line
+    void report(std::ostream & out, const std::vector<BatchJob> & jobs,
+                const std::vector<BatchResult> & results, double seconds, size_t threads);
+}
@@ -0,0 +1,118 @@
+#include "BatchRenderer.h"
+#include <cmath>
+
+BatchRenderer::BatchRenderer()
+    : m_vertices(sf::Triangles)
+{}
+
+const BatchRenderer::UnitPolygon & BatchRenderer::polygon(size_t points)
+{
+    if (points >= m_polygons.size())
+    {
+        m_polygons.resize(points + 1);
+    }
+
+    UnitPolygon & poly = m_polygons[points];
+    if (poly.cosA.empty())
+    {
+        // Same corner placement as sf::CircleShape::getPoint: the first
+        // corner points straight up and the rest follow clockwise
+        const float pi = 3.141592654f;
+        for (size_t i = 0; i < points; i++)
+        {
+            float a = i * 2 * pi / points - pi / 2;
+            poly.cosA.push_back(std::cos(a));
+            poly.sinA.push_back(std::sin(a));
+        }
+
+        // sf::Shape mitres outline corners, pushing each one out by
+        // thickness / cos(half the exterior angle)
+        poly.outlineScale = 1.0f / std::cos(pi / points);
+    }
+    return poly;
+}
+
+void BatchRenderer::clear()
+{
+    m_vertices.clear();
+}
+
+size_t BatchRenderer::vertexCount(size_t points, float thickness)
+{
+    if (points < 3)
+    {
+        return 0;
+    }
+
+    // A fill fan of one triangle per side, plus two per side of outline
+    polygon(points);
+    return points * 3 + (thickness == 0 ? 0 : points * 6);
+}
+
+void BatchRenderer::resize(size_t vertices)
+{
+    m_vertices.resize(vertices);
+}
+
+void BatchRenderer::write(size_t offset, size_t points, float radius, float thickness,
+                          sf::Color fill, sf::Color outline, float x, float y, float angle)
+{
+    if (points < 3)
+    {
+        return;
+    }
+
+    // Already cached by vertexCount(), so this is a read-only lookup
+    const UnitPolygon & poly = m_polygons[points];
+    float outer = radius + thickness * poly.outlineScale;
+
+    // Rotating every corner by the entity angle is a rotation of the unit vectors
+    float rad = angle * 3.141592654f / 180.0f;
+    float cosR = std::cos(rad);
+    float sinR = std::sin(rad);
+    sf::Vector2f center(x, y);
+
+    for (size_t i = 0; i < points; i++)
+    {
+        size_t j = (i + 1) % points;
+        float dxi = poly.cosA[i] * cosR - poly.sinA[i] * sinR;
+        float dyi = poly.cosA[i] * sinR + poly.sinA[i] * cosR;
+        float dxj = poly.cosA[j] * cosR - poly.sinA[j] * sinR;
+        float dyj = poly.cosA[j] * sinR + poly.sinA[j] * cosR;
+
+        m_vertices[offset++] = sf::Vertex(center, fill);
+        m_vertices[offset++] = sf::Vertex(sf::Vector2f(x + dxi * radius, y + dyi * radius), fill);
+        m_vertices[offset++] = sf::Vertex(sf::Vector2f(x + dxj * radius, y + dyj * radius), fill);
+    }
+
+    if (thickness == 0)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < points; i++)
+    {
+        size_t j = (i + 1) % points;
+        float dxi = poly.cosA[i] * cosR - poly.sinA[i] * sinR;
+        float dyi = poly.cosA[i] * sinR + poly.sinA[i] * cosR;
+        float dxj = poly.cosA[j] * cosR - poly.sinA[j] * sinR;
+        float dyj = poly.cosA[j] * sinR + poly.sinA[j] * cosR;
+
+        sf::Vector2f innerI(x + dxi * radius, y + dyi * radius);
+        sf::Vector2f innerJ(x + dxj * radius, y + dyj * radius);
+        sf::Vector2f outerI(x + dxi * outer, y + dyi * outer);
+        sf::Vector2f outerJ(x + dxj * outer, y + dyj * outer);
+
+        m_vertices[offset++] = sf::Vertex(innerI, outline);
+        m_vertices[offset++] = sf::Vertex(outerI, outline);
+        m_vertices[offset++] = sf::Vertex(innerJ, outline);
+        m_vertices[offset++] = sf::Vertex(innerJ, outline);
+        m_vertices[offset++] = sf::Vertex(outerI, outline);
+        m_vertices[offset++] = sf::Vertex(outerJ, outline);
+    }
+}
+
+const sf::VertexArray & BatchRenderer::vertices() const
+{
+    return m_vertices;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+// Collects every entity polygon drawn in a frame into a single triangle list
+// so the whole batch goes to the GPU in one draw call. Each shape is
+// tessellated exactly the way sf::CircleShape does it (a fill fan plus a
+// mitred outline strip), with the entity's position and rotation baked into
+// the vertex positions and its fill/outline colours (including lifespan
+// alpha) baked into the vertex colours. Shapes are emitted fill-then-outline
+// in submission order, so overlaps look the same as individual draws did.
+//
+// Shapes are written in parallel: size each one with vertexCount(), resize()
+// once, then write() every shape at its own offset from any thread.
+class BatchRenderer
+{
+    struct UnitPolygon
+    {
+        std::vector<float> cosA;
+        std::vector<float> sinA;
+        float outlineScale = 1.0f;  // outline offset per unit thickness at each corner
+    };
+
+    sf::VertexArray             m_vertices;     // reused between frames
+    std::vector<UnitPolygon>    m_polygons;     // cached by point count
+
+    const UnitPolygon & polygon(size_t points);     // builds and caches on first use
+
+public:
+    BatchRenderer();
+
+    void clear();
+
+    // Vertices write() emits for a shape with these fields, e.g. as copied
+    // into a RenderFrame. Not thread-safe: it also caches the shape's unit
+    // polygon, which write() relies on.
+    size_t vertexCount(size_t points, float thickness);
+    void resize(size_t vertices);
+    // Fills [offset, offset + vertexCount(points, thickness)) with the shape,
+    // colours as given (lifespan alpha already applied); safe to call
+    // concurrently for disjoint ranges
+    void write(size_t offset, size_t points, float radius, float thickness,
+               sf::Color fill, sf::Color outline, float x, float y, float angle);
+    const sf::VertexArray & vertices() const;
+};
@@ -0,0 +1,42 @@
+#include "Collision.h"
+
+#include <cmath>
+
+float Collision::sweptCircles(const Vec2 & a0, const Vec2 & a1,
+                              const Vec2 & b0, const Vec2 & b1, float reach)
+{
+    // Seen from a, b moves from d to d + v; the first t with |d + t v| = reach
+    // is the smaller root of |v|^2 t^2 + 2 (d.v) t + |d|^2 - reach^2 = 0
+    Vec2 d = b0 - a0;
+    Vec2 v = (b1 - b0) - (a1 - a0);
+    float c = d.x * d.x + d.y * d.y - reach * reach;
+    if (c <= 0.0f)
+    {
+        return 0.0f;
+    }
+
+    // Half the linear coefficient; not closing in means no contact (and
+    // covers v = 0, so a is never zero below)
+    float b = d.x * v.x + d.y * v.y;
+    if (b >= 0.0f)
+    {
+        return -1.0f;
+    }
+    float a = v.x * v.x + v.y * v.y;
+    float disc = b * b - a * c;
+    if (disc < 0.0f)
+    {
+        return -1.0f;
+    }
+
+    float t = (-b - std::sqrt(disc)) / a;
+    if (t <= 1.0f)
+    {
+        return t;
+    }
+
+    // Rounding can push a contact right at the end of the tick past 1; an
+    // overlap there must still count, as it did for the end-of-tick test
+    Vec2 e = d + v;
+    return e.x * e.x + e.y * e.y <= reach * reach ? 1.0f : -1.0f;
+}
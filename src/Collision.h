@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Vec2.h"
+
+// Continuous collision tests. Each moving thing is taken to travel in a
+// straight line over the tick, from where it was (ComponentStore::prevX/Y)
+// to where it is, so two things that pass through each other within the
+// tick still meet, however fast they move or however long the tick is.
+namespace Collision
+{
+    // The earliest fraction of the tick, in [0, 1], at which circles moving
+    // from a0 to a1 and from b0 to b1 come within reach (the sum of their
+    // radii) of each other, or a negative value if they never do. Circles
+    // already touching at the start meet at 0.
+    float sweptCircles(const Vec2 & a0, const Vec2 & a1,
+                       const Vec2 & b0, const Vec2 & b1, float reach);
+}
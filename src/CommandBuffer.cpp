@@ -0,0 +1,114 @@
+#include "CommandBuffer.h"
+#include "Prefab.h"
+
+#include <algorithm>
+
+namespace
+{
+    template <typename C>
+    void attach(EntityManager & entities, Entity entity, const C & component)
+    {
+        entities.addComponent(entity, component);
+    }
+
+    void attach(EntityManager & entities, Entity entity, const CommandBuffer::ShapeSpec & s)
+    {
+        entities.addShape(entity).set(s.radius, s.points, s.fill, s.outline, s.thickness);
+    }
+
+    void attach(EntityManager & entities, Entity entity, const CommandBuffer::Fill & f)
+    {
+        entities.components().shape[entities.row(entity)].circle.setFillColor(f.color);
+    }
+}
+
+CommandBuffer::Spawn CommandBuffer::spawn(TagId tag)
+{
+    m_spawns.push_back({ tag, nullptr });
+    return static_cast<Spawn>(m_spawns.size() - 1);
+}
+
+CommandBuffer::Spawn CommandBuffer::spawn(const Prefab & prefab)
+{
+    m_spawns.push_back({ prefab.tag(), &prefab });
+    return static_cast<Spawn>(m_spawns.size() - 1);
+}
+
+void CommandBuffer::destroy(Entity entity)
+{
+    m_destroys.push_back(entity);
+}
+
+size_t CommandBuffer::size() const
+{
+    size_t n = m_spawns.size() + m_destroys.size();
+    n += std::get<0>(m_adds).size() + std::get<1>(m_adds).size() + std::get<2>(m_adds).size();
+    n += std::get<3>(m_adds).size() + std::get<4>(m_adds).size() + std::get<5>(m_adds).size();
+    n += std::get<6>(m_adds).size() + std::get<7>(m_adds).size();
+    return n;
+}
+
+bool CommandBuffer::empty() const
+{
+    return size() == 0;
+}
+
+void CommandBuffer::clear()
+{
+    m_spawns.clear();
+    m_destroys.clear();
+    adds<CTransform>().clear();
+    adds<ShapeSpec>().clear();
+    adds<Fill>().clear();
+    adds<CCollision>().clear();
+    adds<CLifespan>().clear();
+    adds<CBounce>().clear();
+    adds<CScore>().clear();
+    adds<CInput>().clear();
+}
+
+template <typename C>
+void CommandBuffer::apply(EntityManager & entities)
+{
+    for (const auto& a : adds<C>())
+    {
+        // An existing entity may have been destroyed since the command was recorded
+        Entity entity = a.spawn == EXISTING ? a.entity : m_created[a.spawn];
+        if (entities.isActive(entity))
+        {
+            attach(entities, entity, a.component);
+        }
+    }
+}
+
+void CommandBuffer::playback(EntityManager & entities)
+{
+    m_created.clear();
+    for (const Create& c : m_spawns)
+    {
+        m_created.push_back(c.prefab ? entities.instantiate(*c.prefab) : entities.addEntity(c.tag));
+    }
+
+    apply<CTransform>(entities);
+    apply<ShapeSpec>(entities);
+    apply<Fill>(entities);
+    apply<CCollision>(entities);
+    apply<CLifespan>(entities);
+    apply<CBounce>(entities);
+    apply<CScore>(entities);
+    apply<CInput>(entities);
+
+    // In row order, so the rows update() later swaps into each hole do not
+    // depend on the order the destroys were recorded in. Destroying an entity
+    // twice is harmless.
+    std::sort(m_destroys.begin(), m_destroys.end(), [&](Entity a, Entity b)
+    {
+        return entities.row(a) < entities.row(b);
+    });
+    for (Entity entity : m_destroys)
+    {
+        entities.destroy(entity);
+    }
+
+    clear();
+}
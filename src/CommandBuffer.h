@@ -0,0 +1,101 @@
+#pragma once
+
+#include "EntityManager.h"
+#include <tuple>
+#include <vector>
+
+// Records structural changes to the world (spawning entities, destroying
+// them, adding components) for playback at a sync point, so a system can
+// decide on them mid-loop without the world changing under it. Recording
+// only appends to vectors that keep their capacity, so once warmed up it
+// allocates nothing.
+//
+// playback() applies everything in one batched pass: spawns are created in
+// recording order (prefab spawns with their prefab's components) into pools
+// that grow geometrically, components are attached one type at a time,
+// overriding any copied from a prefab, and destroys run sorted by row. A
+// parallel system can give each chunk its own buffer and play them back in
+// chunk order.
+class CommandBuffer
+{
+public:
+    using Spawn = uint32_t;     // a spawn recorded in this buffer, to attach components to
+
+    // The sf::CircleShape fields of a spawn's shape, set on its pooled shape
+    // at playback
+    struct ShapeSpec
+    {
+        float       radius;
+        int         points;
+        sf::Color   fill;
+        sf::Color   outline;
+        float       thickness;
+    };
+
+    // A new fill colour for the shape an entity already has, e.g. one
+    // copied from a prefab
+    struct Fill
+    {
+        sf::Color   color;
+    };
+
+private:
+    static const uint32_t EXISTING = 0xFFFFFFFFu;
+
+    struct Create
+    {
+        TagId           tag;
+        const Prefab*   prefab;     // copied from, or nullptr for an empty entity
+    };
+
+    template <typename C>
+    struct Add
+    {
+        Entity      entity;     // the entity, if it already exists
+        uint32_t    spawn;      // otherwise the spawn in this buffer
+        C           component;
+    };
+
+    std::vector<Create> m_spawns;
+    EntityVec           m_created;      // the entity made for each spawn, during playback
+    EntityVec           m_destroys;
+    std::tuple<std::vector<Add<CTransform>>,
+               std::vector<Add<ShapeSpec>>,
+               std::vector<Add<Fill>>,
+               std::vector<Add<CCollision>>,
+               std::vector<Add<CLifespan>>,
+               std::vector<Add<CBounce>>,
+               std::vector<Add<CScore>>,
+               std::vector<Add<CInput>>> m_adds;
+
+    template <typename C>
+    std::vector<Add<C>> & adds()
+    {
+        return std::get<std::vector<Add<C>>>(m_adds);
+    }
+
+    template <typename C>
+    void apply(EntityManager & entities);
+
+public:
+    Spawn spawn(TagId tag);
+    Spawn spawn(const Prefab & prefab);     // the prefab must outlive playback()
+    void destroy(Entity entity);
+
+    template <typename C>
+    void add(Spawn spawn, const C & component)
+    {
+        adds<C>().push_back({ Entity(), spawn, component });
+    }
+
+    template <typename C>
+    void add(Entity entity, const C & component)
+    {
+        adds<C>().push_back({ entity, EXISTING, component });
+    }
+
+    size_t size() const;                // commands recorded
+    bool empty() const;
+    void clear();                       // drop every command unplayed
+    void playback(EntityManager & entities);    // apply every command, then clear
+};
@@ -9,9 +9,10 @@ public:
     Vec2 pos = {0.0, 0.0};
     Vec2 velocity = {0.0, 0.0};
     float angle = 0;
+    float spin = 0;     // degrees added to angle every frame
 
-    CTransform(const Vec2& p, const Vec2& v, float a)
-        : pos(p), velocity(v), angle(a) {}
+    CTransform(const Vec2& p, const Vec2& v, float a, float s = 0)
+        : pos(p), velocity(v), angle(a), spin(s) {}
 
 };
 
@@ -20,8 +21,16 @@ class CShape
 public:
     sf::CircleShape circle;
 
+    CShape() {}
     CShape(float radius, int points, const sf::Color& fill,
            const sf::Color& outline, float thickness)
+    {
+        set(radius, points, fill, outline, thickness);
+    }
+
+    // Re-initialises the shape in place, reusing its vertex storage
+    void set(float radius, int points, const sf::Color& fill,
+             const sf::Color& outline, float thickness)
     {
         circle.setRadius(radius);
         circle.setPointCount(points);
@@ -59,6 +68,13 @@ public:
         :remaining(total), total(total) {}
 };
 
+// Marks an entity that bounces off the edges of the world
+class CBounce
+{
+public:
+    CBounce() {}
+};
+
 class CInput
 {
 public:
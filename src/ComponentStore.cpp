@@ -0,0 +1,324 @@
+#include "ComponentStore.h"
+
+#include <algorithm>
+
+size_t ComponentStore::size() const
+{
+    return m_size;
+}
+
+void ComponentStore::grow(size_t rows)
+{
+    size_t capacity = mask.capacity();
+    mask.resize(rows);
+    posX.resize(rows);
+    posY.resize(rows);
+    velX.resize(rows);
+    velY.resize(rows);
+    angle.resize(rows);
+    spin.resize(rows);
+    prevX.resize(rows);
+    prevY.resize(rows);
+    prevAngle.resize(rows);
+    bounce.resize(rows);
+    collisionRadius.resize(rows);
+    lifeExpiry.resize(rows);
+    lifeTotal.resize(rows);
+    score.resize(rows);
+    shape.resize(rows);
+    input.resize(rows);
+    m_rows = rows;
+    if (mask.capacity() != capacity)
+    {
+        m_grows++;
+    }
+}
+
+size_t ComponentStore::claim()
+{
+    size_t row = m_size;
+    if (row == m_rows)
+    {
+        grow(row + 1);
+    }
+    m_size++;
+    m_highWater = std::max(m_highWater, m_size);
+    return row;
+}
+
+size_t ComponentStore::push()
+{
+    size_t row = claim();
+
+    // A recycled row still holds its last owner's data; start it out with no
+    // components. The shape and input keep their storage for reuse.
+    mask[row] = 0;
+    posX[row] = 0.0f;
+    posY[row] = 0.0f;
+    velX[row] = 0.0f;
+    velY[row] = 0.0f;
+    angle[row] = 0.0f;
+    spin[row] = 0.0f;
+    prevX[row] = 0.0f;
+    prevY[row] = 0.0f;
+    prevAngle[row] = 0.0f;
+    bounce[row] = 0;
+    collisionRadius[row] = 0.0f;
+    lifeExpiry[row] = 0;
+    lifeTotal[row] = 0;
+    score[row] = 0;
+    input[row] = CInput();
+    return row;
+}
+
+size_t ComponentStore::push(const ComponentStore & from, size_t fromRow)
+{
+    // Every column is written straight from the source row, so unlike push()
+    // nothing is cleared first. Assigning the shape copies its vertices into
+    // the pooled shape's storage rather than recomputing them.
+    size_t row = claim();
+    mask[row] = from.mask[fromRow];
+    posX[row] = from.posX[fromRow];
+    posY[row] = from.posY[fromRow];
+    velX[row] = from.velX[fromRow];
+    velY[row] = from.velY[fromRow];
+    angle[row] = from.angle[fromRow];
+    spin[row] = from.spin[fromRow];
+    prevX[row] = from.prevX[fromRow];
+    prevY[row] = from.prevY[fromRow];
+    prevAngle[row] = from.prevAngle[fromRow];
+    bounce[row] = from.bounce[fromRow];
+    collisionRadius[row] = from.collisionRadius[fromRow];
+    lifeExpiry[row] = from.lifeExpiry[fromRow];
+    lifeTotal[row] = from.lifeTotal[fromRow];
+    score[row] = from.score[fromRow];
+    shape[row] = from.shape[fromRow];
+    input[row] = from.input[fromRow];
+    return row;
+}
+
+void ComponentStore::move(size_t from, size_t to)
+{
+    mask[to] = mask[from];
+    posX[to] = posX[from];
+    posY[to] = posY[from];
+    velX[to] = velX[from];
+    velY[to] = velY[from];
+    angle[to] = angle[from];
+    spin[to] = spin[from];
+    prevX[to] = prevX[from];
+    prevY[to] = prevY[from];
+    prevAngle[to] = prevAngle[from];
+    bounce[to] = bounce[from];
+    collisionRadius[to] = collisionRadius[from];
+    lifeExpiry[to] = lifeExpiry[from];
+    lifeTotal[to] = lifeTotal[from];
+    score[to] = score[from];
+    // Swap rather than move so the vacated row keeps a shape to reuse
+    std::swap(shape[to], shape[from]);
+    input[to] = input[from];
+}
+
+void ComponentStore::truncate(size_t rows)
+{
+    m_size = std::min(rows, m_size);
+}
+
+void ComponentStore::reserve(size_t rows)
+{
+    if (rows > m_rows)
+    {
+        grow(rows);
+    }
+}
+
+PoolStats ComponentStore::stats() const
+{
+    PoolStats s;
+    s.live = m_size;
+    s.capacity = m_rows;
+    s.highWater = m_highWater;
+    s.grows = m_grows;
+    return s;
+}
+
+namespace
+{
+    // sf::Shape keeps a fill fan of points + 2 vertices and an outline strip
+    // of 2 * (points + 1), whether the outline is drawn or not
+    size_t vertexBytes(const CShape & s)
+    {
+        size_t points = s.circle.getPointCount();
+        return (points + 2 + 2 * (points + 1)) * sizeof(sf::Vertex);
+    }
+
+    template <typename T>
+    size_t columnBytes(const std::vector<T> &, size_t rows)
+    {
+        return rows * sizeof(T);
+    }
+
+    template <typename T>
+    size_t columnReserved(const std::vector<T> & column)
+    {
+        return column.capacity() * sizeof(T);
+    }
+}
+
+void ComponentStore::memory(std::vector<Memory::Usage> & out) const
+{
+    size_t holders[8] = {};
+    for (size_t row = 0; row < m_size; row++)
+    {
+        for (int bit = 0; bit < 8; bit++)
+        {
+            holders[bit] += (mask[row] >> bit) & 1;
+        }
+    }
+
+    size_t shapeHeap = 0;
+    size_t shapeHeapBuilt = 0;
+    for (size_t row = 0; row < m_rows; row++)
+    {
+        size_t bytes = vertexBytes(shape[row]);
+        shapeHeap += row < m_size ? bytes : 0;
+        shapeHeapBuilt += bytes;
+    }
+
+    out.push_back({ "mask", m_size, columnBytes(mask, m_size), columnReserved(mask) });
+    out.push_back({ "CTransform", holders[0],
+        columnBytes(posX, m_size) + columnBytes(posY, m_size) + columnBytes(velX, m_size)
+            + columnBytes(velY, m_size) + columnBytes(angle, m_size) + columnBytes(spin, m_size)
+            + columnBytes(prevX, m_size) + columnBytes(prevY, m_size) + columnBytes(prevAngle, m_size),
+        columnReserved(posX) + columnReserved(posY) + columnReserved(velX)
+            + columnReserved(velY) + columnReserved(angle) + columnReserved(spin)
+            + columnReserved(prevX) + columnReserved(prevY) + columnReserved(prevAngle) });
+    out.push_back({ "CShape", holders[1],
+        columnBytes(shape, m_size) + shapeHeap, columnReserved(shape) + shapeHeapBuilt });
+    out.push_back({ "CCollision", holders[2],
+        columnBytes(collisionRadius, m_size), columnReserved(collisionRadius) });
+    out.push_back({ "CInput", holders[3], columnBytes(input, m_size), columnReserved(input) });
+    out.push_back({ "CScore", holders[4], columnBytes(score, m_size), columnReserved(score) });
+    out.push_back({ "CLifespan", holders[5],
+        columnBytes(lifeExpiry, m_size) + columnBytes(lifeTotal, m_size),
+        columnReserved(lifeExpiry) + columnReserved(lifeTotal) });
+    out.push_back({ "CBounce", holders[6], columnBytes(bounce, m_size), columnReserved(bounce) });
+}
+
+size_t ComponentStore::rowBytes(size_t row) const
+{
+    return sizeof(mask[0]) + sizeof(posX[0]) + sizeof(posY[0]) + sizeof(velX[0]) + sizeof(velY[0])
+        + sizeof(angle[0]) + sizeof(spin[0]) + sizeof(prevX[0]) + sizeof(prevY[0]) + sizeof(prevAngle[0])
+        + sizeof(bounce[0]) + sizeof(collisionRadius[0]) + sizeof(lifeExpiry[0]) + sizeof(lifeTotal[0])
+        + sizeof(score[0]) + sizeof(shape[0]) + sizeof(input[0]) + vertexBytes(shape[row]);
+}
+
+bool ComponentStore::has(size_t row, uint8_t bits) const
+{
+    return (mask[row] & bits) == bits;
+}
+
+void ComponentStore::add(size_t row, const CTransform & c)
+{
+    mask[row] |= Components::Transform;
+    posX[row] = c.pos.x;
+    posY[row] = c.pos.y;
+    velX[row] = c.velocity.x;
+    velY[row] = c.velocity.y;
+    angle[row] = c.angle;
+    spin[row] = c.spin;
+    // A new transform has no previous tick to interpolate from
+    prevX[row] = c.pos.x;
+    prevY[row] = c.pos.y;
+    prevAngle[row] = c.angle;
+}
+
+void ComponentStore::add(size_t row, const CShape & c)
+{
+    mask[row] |= Components::Shape;
+    shape[row] = c;
+}
+
+CShape & ComponentStore::addShape(size_t row)
+{
+    mask[row] |= Components::Shape;
+    return shape[row];
+}
+
+void ComponentStore::add(size_t row, const CCollision & c)
+{
+    mask[row] |= Components::Collision;
+    collisionRadius[row] = c.radius;
+}
+
+void ComponentStore::add(size_t row, const CInput & c)
+{
+    mask[row] |= Components::Input;
+    input[row] = c;
+}
+
+void ComponentStore::add(size_t row, const CScore & c)
+{
+    mask[row] |= Components::Score;
+    score[row] = c.score;
+}
+
+void ComponentStore::add(size_t row, const CLifespan & c, uint32_t now)
+{
+    mask[row] |= Components::Lifespan;
+    lifeExpiry[row] = now + static_cast<uint32_t>(c.remaining > 0 ? c.remaining : 0);
+    // A zero-length lifespan still has to expire on the next sLifespan
+    lifeTotal[row] = c.total > 0 ? c.total : 1;
+}
+
+void ComponentStore::add(size_t row, const CBounce &)
+{
+    mask[row] |= Components::Bounce;
+    bounce[row] = ~0u;
+}
+
+int ComponentStore::alpha(size_t row, uint32_t now) const
+{
+    if (lifeTotal[row] == 0)
+    {
+        return 255;
+    }
+    int64_t remaining = static_cast<int32_t>(lifeExpiry[row] - now);
+    return static_cast<int>(255 * (remaining > 0 ? remaining : 0) / lifeTotal[row]);
+}
+
+Vec2 ComponentStore::pos(size_t row) const
+{
+    return Vec2(posX[row], posY[row]);
+}
+
+Vec2 ComponentStore::velocity(size_t row) const
+{
+    return Vec2(velX[row], velY[row]);
+}
+
+void ComponentStore::setPos(size_t row, const Vec2 & p)
+{
+    posX[row] = p.x;
+    posY[row] = p.y;
+    prevX[row] = p.x;
+    prevY[row] = p.y;
+}
+
+void ComponentStore::savePrevious(size_t begin, size_t end)
+{
+    std::copy(posX.begin() + begin, posX.begin() + end, prevX.begin() + begin);
+    std::copy(posY.begin() + begin, posY.begin() + end, prevY.begin() + begin);
+    std::copy(angle.begin() + begin, angle.begin() + end, prevAngle.begin() + begin);
+}
+
+Vec2 ComponentStore::lerpPos(size_t row, float t) const
+{
+    return Vec2(prevX[row] + (posX[row] - prevX[row]) * t,
+                prevY[row] + (posY[row] - prevY[row]) * t);
+}
+
+float ComponentStore::lerpAngle(size_t row, float t) const
+{
+    return prevAngle[row] + (angle[row] - prevAngle[row]) * t;
+}
@@ -0,0 +1,221 @@
+#pragma once
+
+#include "Component.h"
+#include "Memory.h"
+#include <vector>
+#include <cstdint>
+
+// Bits recording which components a row holds
+namespace Components
+{
+    enum Bits : uint8_t
+    {
+        Transform = 1 << 0,
+        Shape     = 1 << 1,
+        Collision = 1 << 2,
+        Input     = 1 << 3,
+        Score     = 1 << 4,
+        Lifespan  = 1 << 5,
+        Bounce    = 1 << 6,
+        Alive     = 1 << 7      // set from addEntity() until destroy()
+    };
+}
+
+// Occupancy counters for the entity and component pools
+struct PoolStats
+{
+    size_t live = 0;        // entries in use right now
+    size_t capacity = 0;    // entries the pool can hold without allocating
+    size_t highWater = 0;   // most entries ever in use at once
+    size_t grows = 0;       // times the pool had to allocate more storage
+};
+
+// Structure-of-arrays storage for every entity's components.
+// Row i of every array belongs to the same entity, and rows are kept packed:
+// the EntityManager compacts them when dead entities are removed, so a system
+// can walk [0, size()) and touch only the arrays it needs.
+//
+// The store is also the component pool. Rows past size() are never freed:
+// a removed row keeps its objects (and the vertex buffers inside its
+// sf::CircleShape) for the next entity to reuse, so once the world has
+// reached its high-water mark, spawning and removing entities allocates
+// nothing.
+class ComponentStore
+{
+    size_t m_size = 0;      // rows in use
+    size_t m_rows = 0;      // rows built in the arrays, in use or not
+    size_t m_highWater = 0;
+    size_t m_grows = 0;
+
+    void grow(size_t rows);
+    size_t claim();         // the next row, its data left as it was
+
+public:
+    // Component presence, one byte per row
+    std::vector<uint8_t>    mask;
+
+    // CTransform
+    std::vector<float>      posX;
+    std::vector<float>      posY;
+    std::vector<float>      velX;
+    std::vector<float>      velY;
+    std::vector<float>      angle;
+    std::vector<float>      spin;
+
+    // CTransform as of the start of the current simulation tick, so rendering
+    // can interpolate between the last two ticks
+    std::vector<float>      prevX;
+    std::vector<float>      prevY;
+    std::vector<float>      prevAngle;
+
+    // CBounce, as a SIMD lane mask: ~0u for rows that bounce, 0 otherwise
+    std::vector<uint32_t>   bounce;
+
+    // CCollision
+    std::vector<float>      collisionRadius;
+
+    // CLifespan, as the tick it runs out on (see EntityManager::lifespanTick)
+    // and its full length. lifeTotal is zero exactly for rows without one.
+    std::vector<uint32_t>   lifeExpiry;
+    std::vector<int>        lifeTotal;
+
+    // CScore
+    std::vector<int>        score;
+
+    // Shapes and input are cold (render / player only), so they stay whole
+    std::vector<CShape>     shape;
+    std::vector<CInput>     input;
+
+    size_t size() const;
+    size_t push();                          // claim an empty row at the end and return its index
+    size_t push(const ComponentStore & from, size_t fromRow);  // the same, holding a copy of from's row
+    void move(size_t from, size_t to);      // overwrite row 'to' with row 'from'
+    void truncate(size_t rows);             // release every row from 'rows' on, keeping its storage
+    void reserve(size_t rows);              // pre-build rows so the first 'rows' pushes never allocate
+    PoolStats stats() const;
+
+    // One entry per component type (and the mask), counting the rows that
+    // hold it. Columns are dense, so bytes covers every row in use whether
+    // it holds the component or not; shapes include their vertex storage.
+    void memory(std::vector<Memory::Usage> & out) const;
+    size_t rowBytes(size_t row) const;      // what one row costs across every column, vertices included
+
+    bool has(size_t row, uint8_t bits) const;
+
+    void add(size_t row, const CTransform & c);
+    void add(size_t row, const CShape & c);
+    void add(size_t row, const CCollision & c);
+    void add(size_t row, const CInput & c);
+    void add(size_t row, const CScore & c);
+    void add(size_t row, const CLifespan & c, uint32_t now); // expires c.remaining ticks after now
+    void add(size_t row, const CBounce & c);
+    CShape & addShape(size_t row);          // the row's pooled shape, to set() in place
+
+    // Calls fn(name, data, bytesPerRow) for every plain-data array, always in
+    // the same order. Rows [0, size()) of each are contiguous, so whole
+    // columns can be copied in one go (snapshots, memory accounting).
+    template <typename F>
+    void forEachColumn(F && fn)
+    {
+        fn("mask", static_cast<void*>(mask.data()), sizeof(uint8_t));
+        fn("posX", static_cast<void*>(posX.data()), sizeof(float));
+        fn("posY", static_cast<void*>(posY.data()), sizeof(float));
+        fn("velX", static_cast<void*>(velX.data()), sizeof(float));
+        fn("velY", static_cast<void*>(velY.data()), sizeof(float));
+        fn("angle", static_cast<void*>(angle.data()), sizeof(float));
+        fn("spin", static_cast<void*>(spin.data()), sizeof(float));
+        fn("prevX", static_cast<void*>(prevX.data()), sizeof(float));
+        fn("prevY", static_cast<void*>(prevY.data()), sizeof(float));
+        fn("prevAngle", static_cast<void*>(prevAngle.data()), sizeof(float));
+        fn("bounce", static_cast<void*>(bounce.data()), sizeof(uint32_t));
+        fn("collisionRadius", static_cast<void*>(collisionRadius.data()), sizeof(float));
+        fn("lifeExpiry", static_cast<void*>(lifeExpiry.data()), sizeof(uint32_t));
+        fn("lifeTotal", static_cast<void*>(lifeTotal.data()), sizeof(int));
+        fn("score", static_cast<void*>(score.data()), sizeof(int));
+    }
+
+    int alpha(size_t row, uint32_t now) const;  // lifespan fade at tick now, 0-255 (255 without a lifespan)
+    Vec2 pos(size_t row) const;
+    Vec2 velocity(size_t row) const;
+    void setPos(size_t row, const Vec2 & p);   // jump there, with no interpolation from the old position
+
+    void savePrevious(size_t begin, size_t end);    // rows [begin, end): prev = current transform
+    Vec2 lerpPos(size_t row, float t) const;        // t = 0 is the previous tick, 1 the current one
+    float lerpAngle(size_t row, float t) const;
+};
+
+// Typed access to one row's components for EntityManager::view(). The
+// structure-of-arrays store has no component objects to hand out, so each of
+// these bundles references into the arrays instead. Like any reference into
+// the store, they are only valid until the next entity is added.
+struct TransformRef
+{
+    float& x;
+    float& y;
+    float& vx;
+    float& vy;
+    float& angle;
+    float& spin;
+
+    Vec2 pos() const { return Vec2(x, y); }
+};
+
+struct CollisionRef { float& radius; };
+struct LifespanRef  { uint32_t& expiry; int& total; };
+struct ScoreRef     { int& score; };
+
+// Maps a component type to its mask bit and to its view reference
+template <typename C> struct ComponentAccess;
+
+template <> struct ComponentAccess<CTransform>
+{
+    static const uint8_t bit = Components::Transform;
+    static TransformRef get(ComponentStore & c, size_t row)
+    {
+        return { c.posX[row], c.posY[row], c.velX[row], c.velY[row], c.angle[row], c.spin[row] };
+    }
+};
+
+template <> struct ComponentAccess<CShape>
+{
+    static const uint8_t bit = Components::Shape;
+    static CShape & get(ComponentStore & c, size_t row) { return c.shape[row]; }
+};
+
+template <> struct ComponentAccess<CCollision>
+{
+    static const uint8_t bit = Components::Collision;
+    static CollisionRef get(ComponentStore & c, size_t row) { return { c.collisionRadius[row] }; }
+};
+
+template <> struct ComponentAccess<CInput>
+{
+    static const uint8_t bit = Components::Input;
+    static CInput & get(ComponentStore & c, size_t row) { return c.input[row]; }
+};
+
+template <> struct ComponentAccess<CScore>
+{
+    static const uint8_t bit = Components::Score;
+    static ScoreRef get(ComponentStore & c, size_t row) { return { c.score[row] }; }
+};
+
+template <> struct ComponentAccess<CLifespan>
+{
+    static const uint8_t bit = Components::Lifespan;
+    static LifespanRef get(ComponentStore & c, size_t row) { return { c.lifeExpiry[row], c.lifeTotal[row] }; }
+};
+
+template <> struct ComponentAccess<CBounce>
+{
+    // A marker with no data: requiring it filters the view, nothing more
+    static const uint8_t bit = Components::Bounce;
+    static CBounce get(ComponentStore &, size_t) { return CBounce(); }
+};
+
+// The mask bits a row needs to hold every one of Cs
+template <typename... Cs>
+constexpr uint8_t componentMask()
+{
+    return static_cast<uint8_t>((0 | ... | ComponentAccess<Cs>::bit));
+}
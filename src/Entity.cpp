@@ -1,26 +1,30 @@
 #include "Entity.h"
 
-Entity::Entity(const size_t id, const std::string & tag)
-    : m_id(id)
-    , m_tag(tag)
+Entity::Entity(uint32_t slot, uint32_t generation)
+    : m_handle((generation << INDEX_BITS) | slot)
     {}
 
-bool Entity::isActive() const
+uint32_t Entity::slot() const
 {
-    return this->m_active;
+    return this->m_handle & (MAX_SLOTS - 1);
 }
 
-const std::string& Entity::tag() const
+uint32_t Entity::generation() const
 {
-    return this->m_tag;
+    return this->m_handle >> INDEX_BITS;
 }
 
-const std::size_t Entity::id() const
+uint32_t Entity::id() const
 {
-    return this->m_id;
+    return this->m_handle;
 }
 
-void Entity::destroy()
+bool Entity::operator == (const Entity & rhs) const
 {
-    this->m_active = false;
-}
\ No newline at end of file
+    return this->m_handle == rhs.m_handle;
+}
+
+bool Entity::operator != (const Entity & rhs) const
+{
+    return this->m_handle != rhs.m_handle;
+}
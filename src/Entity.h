@@ -1,32 +1,33 @@
 #pragma once
 
-#include "Component.h"
-#include <string>
-#include <memory>
+#include <cstdint>
+#include <cstddef>
 
+// A 32-bit handle to an entity owned by the EntityManager.
+// The low INDEX_BITS select a slot and the high bits hold the generation the
+// slot had when the handle was issued. Removing an entity bumps its slot's
+// generation, so a handle kept past that point (a stale m_player, say) no
+// longer matches and EntityManager::isValid() rejects it in O(1).
 class Entity
 {
     friend class EntityManager;
 
-    bool m_active = true;
-    size_t m_id = 0;
-    std::string m_tag = "default";
-    
-    Entity(const size_t id, const std::string & tag);
+    uint32_t m_handle = INVALID;
+
+    Entity(uint32_t slot, uint32_t generation);
 
 public:
+    static const uint32_t INDEX_BITS = 22;
+    static const uint32_t MAX_SLOTS = 1u << INDEX_BITS;
+    static const uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+    static const uint32_t INVALID = 0xFFFFFFFFu;
+
+    Entity() {}
+
+    uint32_t slot() const;
+    uint32_t generation() const;
+    uint32_t id() const;
 
-    // Component pointers
-    std::shared_ptr<CTransform> cTransform;
-    std::shared_ptr<CShape> cShape;
-    std::shared_ptr<CCollision> cCollision;
-    std::shared_ptr<CInput> cInput;
-    std::shared_ptr<CScore> cScore;
-    std::shared_ptr<CLifespan> cLifespan;
-
-    // Private member access functions
-    bool isActive() const;
-    const std::string& tag() const;
-    const size_t id() const;
-    void destroy();
-};
\ No newline at end of file
+    bool operator == (const Entity & rhs) const;
+    bool operator != (const Entity & rhs) const;
+};
@@ -1,63 +1,517 @@
 #include "EntityManager.h"
+#include "Prefab.h"
 #include "Entity.h"
 
+#include <algorithm>
+#include <cassert>
+
 EntityManager::EntityManager() {}
 
-std::shared_ptr<Entity> EntityManager::createEntity(const size_t id, const std::string& tag)
+Entity EntityManager::createEntity(TagId tag, const ComponentStore * prefab)
 {
-    return std::shared_ptr<Entity>(new Entity(id, tag));
+    // Reuse a free slot if there is one, otherwise grow the slot table
+    uint32_t slot = m_freeSlot;
+    if (slot != NO_SLOT)
+    {
+        m_freeSlot = m_slots[slot].next;
+    } else
+    {
+        // The last slot is reserved so no live handle can equal Entity::INVALID
+        assert(m_slots.size() < Entity::MAX_SLOTS - 1);
+        slot = static_cast<uint32_t>(m_slots.size());
+        if (m_slots.size() == m_slots.capacity())
+        {
+            m_slotGrows++;
+        }
+        m_slots.emplace_back();
+    }
+
+    Slot& s = m_slots[slot];
+    s.row = static_cast<uint32_t>(prefab ? m_components.push(*prefab, 0) : m_components.push());
+    m_components.mask[s.row] |= Components::Alive;
+    s.next = NO_SLOT;
+    s.active = true;
+    s.tag = tag;
+    return Entity(slot, s.generation);
 }
 
-void EntityManager::removeDeadEntities(EntityVec & vec)
+void EntityManager::releaseSlot(uint32_t slot)
 {
-    vec.erase(
-        // std::remove_if returns the index of the first element to be removed after sorting 
-        std::remove_if(vec.begin(), vec.end(),
-            //lambda function to sort and move the false-returning items to the back
-            [](const std::shared_ptr<Entity>& entity) {
-                return !entity->isActive();
-            }),
-        vec.end());
+    // Bumping the generation invalidates every handle issued for this slot
+    Slot& s = m_slots[slot];
+    s.generation = (s.generation + 1) & Entity::GENERATION_MASK;
+    s.active = false;
+    s.next = m_freeSlot;
+    m_freeSlot = slot;
+}
+
+void EntityManager::removeEntity(Entity entity)
+{
+    Slot& s = m_slots[entity.slot()];
+    m_lifespans.cancel(entity);
+
+    // Fill the hole in the rows and the entity list with the last entry
+    size_t last = m_entities.size() - 1;
+    if (s.row != last)
+    {
+        Entity moved = m_entities[last];
+        m_components.move(last, s.row);
+        m_entities[s.row] = moved;
+        m_slots[moved.slot()].row = s.row;
+    }
+    m_entities.pop_back();
+    m_components.truncate(last);
+
+    // Likewise in its tag's list
+    EntityVec& tagged = m_tagEntities[s.tag];
+    if (s.tagIndex != tagged.size() - 1)
+    {
+        Entity moved = tagged.back();
+        tagged[s.tagIndex] = moved;
+        m_slots[moved.slot()].tagIndex = s.tagIndex;
+    }
+    tagged.pop_back();
+
+    releaseSlot(entity.slot());
 }
 
 void EntityManager::update()
 {
-    // Create entities from buffer
+    // Commit the pending entities. Their component rows already follow the
+    // committed ones, so only the lists need extending.
     for (auto& e : m_entitiesToAdd)
     {
+        Slot& s = m_slots[e.slot()];
+        EntityVec& tagged = m_tagEntities[s.tag];
+        s.tagIndex = static_cast<uint32_t>(tagged.size());
+        tagged.push_back(e);
         m_entities.push_back(e);
-        m_entityMap[e->m_tag].push_back(e);
-        m_totalEntities += 1;
+    }
+    m_entitiesToAdd.clear();
+
+    // Their lifespans start now; until this point lifeExpiry held the ticks remaining
+    for (auto& e : m_lifespansToAdd)
+    {
+        size_t r = row(e);
+        m_components.lifeExpiry[r] += m_lifespans.now();
+        m_lifespans.schedule(e, m_components.lifeExpiry[r]);
+    }
+    m_lifespansToAdd.clear();
+
+    // Remove the entities destroyed since the last update. Each removal is a
+    // swap-and-pop, so this costs in proportion to the number destroyed, not
+    // to the size of the world.
+    for (auto& e : m_destroyed)
+    {
+        removeEntity(e);
+    }
+    m_destroyed.clear();
+    positionsChanged();
+}
+
+void EntityManager::clear()
+{
+    for (auto& e : m_entities)
+    {
+        destroy(e);
+    }
+    for (auto& e : m_entitiesToAdd)
+    {
+        destroy(e);
+    }
+
+    // update() commits the pending entities first, so they are removed too
+    update();
+}
+
+TagId EntityManager::tagId(const std::string & tag)
+{
+    auto it = m_tagIds.find(tag);
+    if (it != m_tagIds.end())
+    {
+        return it->second;
+    }
+
+    assert(m_tagNames.size() <= 0xFFFF);
+    TagId id = static_cast<TagId>(m_tagNames.size());
+    m_tagNames.push_back(tag);
+    m_tagEntities.emplace_back();
+    m_tagIds.emplace(tag, id);
+    return id;
+}
+
+const std::string & EntityManager::tagName(TagId tag) const
+{
+    return m_tagNames[tag];
+}
+
+size_t EntityManager::tagCount() const
+{
+    return m_tagNames.size();
+}
+
+bool EntityManager::setTagOrder(TagId tag, const std::vector<uint32_t> & rows)
+{
+    EntityVec& tagged = m_tagEntities[tag];
+    if (rows.size() != tagged.size())
+    {
+        return false;
     }
 
-    if (!m_entitiesToAdd.empty())
+    // Every row must be a committed entity with this tag, and none repeated:
+    // the tag indices double as the "already seen" marks
+    for (auto& e : tagged)
     {
-        m_entitiesToAdd.clear();
+        m_slots[e.slot()].tagIndex = NO_SLOT;
+    }
+    bool valid = true;
+    for (size_t i = 0; i < rows.size() && valid; i++)
+    {
+        valid = rows[i] < m_entities.size();
+        if (valid)
+        {
+            Slot& s = m_slots[m_entities[rows[i]].slot()];
+            valid = s.tag == tag && s.tagIndex == NO_SLOT;
+            if (valid)
+            {
+                // Only this tag's indices are restored below
+                s.tagIndex = static_cast<uint32_t>(i);
+            }
+        }
     }
 
-    // Remove dead entities from the main entity list
-    removeDeadEntities(m_entities);
+    if (valid)
+    {
+        for (size_t i = 0; i < rows.size(); i++)
+        {
+            tagged[i] = m_entities[rows[i]];
+        }
+        positionsChanged();     // the tag's grid refers to list positions
+    }
 
-    // Remove dead entities from the entity map
-    for (auto& [tag, entities] : m_entityMap)
+    // Either way, tagIndex must match the list as it now stands
+    for (size_t i = 0; i < tagged.size(); i++)
     {
-        removeDeadEntities(entities);
+        m_slots[tagged[i].slot()].tagIndex = static_cast<uint32_t>(i);
     }
+    return valid;
 }
 
-std::shared_ptr<Entity> EntityManager::addEntity(const std::string & tag)
+Entity EntityManager::addEntity(TagId tag)
+{
+    auto e = createEntity(tag);
+    m_entitiesToAdd.push_back(e);
+    return e;
+}
+
+Entity EntityManager::addEntity(const std::string & tag)
 {   
-    auto e = createEntity(m_totalEntities, tag);
+    return addEntity(tagId(tag));
+}
+
+Entity EntityManager::instantiate(const Prefab & prefab)
+{
+    auto e = createEntity(prefab.tag(), &prefab.components());
     m_entitiesToAdd.push_back(e);
+
+    // The prefab's lifespan is relative, as for addComponent() on a pending
+    // entity: update() starts it when the entity is committed
+    if (m_components.has(row(e), Components::Lifespan))
+    {
+        m_lifespansToAdd.push_back(e);
+    }
     return e;
 }
 
-const EntityVec & EntityManager::getEntities()
+bool EntityManager::isValid(Entity entity) const
+{
+    return entity.slot() < m_slots.size()
+        && m_slots[entity.slot()].generation == entity.generation();
+}
+
+bool EntityManager::isActive(Entity entity) const
+{
+    return isValid(entity) && m_slots[entity.slot()].active;
+}
+
+void EntityManager::destroy(Entity entity)
+{
+    if (isActive(entity))
+    {
+        m_slots[entity.slot()].active = false;
+        m_components.mask[row(entity)] &= ~Components::Alive;
+        m_destroyed.push_back(entity);
+    }
+}
+
+TagId EntityManager::tagOf(Entity entity) const
+{
+    return m_slots[entity.slot()].tag;
+}
+
+const std::string & EntityManager::tag(Entity entity) const
+{
+    return m_tagNames[m_slots[entity.slot()].tag];
+}
+
+void EntityManager::setQueryCellSize(float cellSize)
+{
+    m_queryCellSize = cellSize;
+    positionsChanged();
+}
+
+void EntityManager::positionsChanged()
+{
+    m_positionsVersion++;
+}
+
+SpatialHash & EntityManager::tagGrid(TagId tag)
+{
+    if (tag >= m_tagGrids.size())
+    {
+        m_tagGrids.resize(m_tagEntities.size());
+    }
+    TagGrid& t = m_tagGrids[tag];
+    if (t.version != m_positionsVersion)
+    {
+        const EntityVec& tagged = m_tagEntities[tag];
+        t.grid.clear(m_queryCellSize);
+        for (size_t i = 0; i < tagged.size(); i++)
+        {
+            size_t r = row(tagged[i]);
+            if (m_components.has(r, Components::Transform))
+            {
+                t.grid.insert(i, m_components.pos(r));
+            }
+        }
+        t.grid.build();
+        t.version = m_positionsVersion;
+    }
+    return t.grid;
+}
+
+size_t EntityManager::queryRadius(const Vec2 & pos, float radius, TagId tag, EntityVec & out)
+{
+    out.clear();
+    const EntityVec& tagged = m_tagEntities[tag];
+    float reach = radius * radius;
+    tagGrid(tag).query(pos, radius, [&](size_t i)
+    {
+        Entity e = tagged[i];
+        if (isActive(e) && pos.distSq(m_components.pos(row(e))) <= reach)
+        {
+            out.push_back(e);
+        }
+    });
+    return out.size();
+}
+
+size_t EntityManager::nearest(const Vec2 & pos, TagId tag, size_t k, EntityVec & out)
+{
+    out.clear();
+    if (k == 0)
+    {
+        return 0;
+    }
+    SpatialHash& grid = tagGrid(tag);
+    const EntityVec& tagged = m_tagEntities[tag];
+
+    // Search a circle that doubles until it holds k entities or covers every
+    // occupied cell. Whatever is inside it is nearer than anything outside,
+    // so its k nearest are the k nearest overall.
+    float limit = grid.farthest(pos);
+    float radius = grid.cellSize();
+    while (true)
+    {
+        m_nearest.clear();
+        float reach = radius * radius;
+        grid.query(pos, radius, [&](size_t i)
+        {
+            Entity e = tagged[i];
+            float d = pos.distSq(m_components.pos(row(e)));
+            if (isActive(e) && d <= reach)
+            {
+                m_nearest.push_back({ d, static_cast<uint32_t>(i) });
+            }
+        });
+        if (m_nearest.size() >= k || radius >= limit)
+        {
+            break;
+        }
+        radius *= 2.0f;
+    }
+
+    // Equal distances go to the earlier list position, so results repeat
+    size_t n = std::min(k, m_nearest.size());
+    std::partial_sort(m_nearest.begin(), m_nearest.begin() + n, m_nearest.end());
+    for (size_t i = 0; i < n; i++)
+    {
+        out.push_back(tagged[m_nearest[i].second]);
+    }
+    return n;
+}
+
+size_t EntityManager::row(Entity entity) const
+{
+    return m_slots[entity.slot()].row;
+}
+
+void EntityManager::reserve(size_t entities)
+{
+    // Nothing to do within capacity; past it, at least double, so calling
+    // this before every spawn still reallocates only O(log n) times
+    size_t capacity = m_slots.capacity();
+    if (entities <= capacity)
+    {
+        return;
+    }
+    size_t target = std::max(entities, 2 * capacity);
+    m_slots.reserve(target);
+    m_entities.reserve(target);
+    m_entitiesToAdd.reserve(target);
+    m_destroyed.reserve(target);
+    m_lifespansToAdd.reserve(target);
+    m_components.reserve(target);
+    m_slotGrows++;
+}
+
+PoolStats EntityManager::entityPool() const
+{
+    // Slots are only appended when the free list is empty, so the table's
+    // length is the most entities ever alive (or pending) at once
+    PoolStats s;
+    s.live = m_entities.size() + m_entitiesToAdd.size();
+    s.capacity = m_slots.capacity();
+    s.highWater = m_slots.size();
+    s.grows = m_slotGrows;
+    return s;
+}
+
+PoolStats EntityManager::componentPool() const
+{
+    return m_components.stats();
+}
+
+void EntityManager::memory(WorldMemory & out) const
+{
+    out.components.clear();
+    out.tags.clear();
+    out.bookkeeping.clear();
+
+    m_components.memory(out.components);
+
+    // A committed entity is listed twice (all entities, its tag) and owns a
+    // slot; its share of the tag list's spare capacity counts as reserved
+    for (TagId t = 0; t < m_tagEntities.size(); t++)
+    {
+        const EntityVec& tagged = m_tagEntities[t];
+        Memory::Usage u{ m_tagNames[t], tagged.size(), 0, 0 };
+        for (Entity e : tagged)
+        {
+            u.bytes += m_components.rowBytes(row(e)) + sizeof(Slot) + 2 * sizeof(Entity);
+        }
+        u.reserved = u.bytes + (tagged.capacity() - tagged.size()) * sizeof(Entity);
+        out.tags.push_back(u);
+    }
+
+    Memory::Usage tagLists{ "tag lists", 0, 0, m_tagEntities.capacity() * sizeof(EntityVec) };
+    for (const EntityVec& tagged : m_tagEntities)
+    {
+        tagLists.count += tagged.size();
+        tagLists.bytes += tagged.size() * sizeof(Entity);
+        tagLists.reserved += tagged.capacity() * sizeof(Entity);
+    }
+
+    out.bookkeeping.push_back(Memory::usage("entities", m_entities));
+    out.bookkeeping.push_back(Memory::usage("pending", m_entitiesToAdd));
+    out.bookkeeping.push_back(Memory::usage("destroyed", m_destroyed));
+    out.bookkeeping.push_back(tagLists);
+    out.bookkeeping.push_back(Memory::usage("slots", m_slots));
+    out.bookkeeping.push_back(m_lifespans.memory());
+    out.bookkeeping.push_back(Memory::usage("lifespans pending", m_lifespansToAdd));
+    out.bookkeeping.push_back(Memory::usage("lifespans due", m_due));
+}
+
+void EntityManager::addComponent(Entity entity, const CLifespan & lifespan)
+{
+    size_t r = row(entity);
+    if (r < m_entities.size())
+    {
+        m_components.add(r, lifespan, m_lifespans.now());
+        m_lifespans.schedule(entity, m_components.lifeExpiry[r]);
+    } else
+    {
+        if (!m_components.has(r, Components::Lifespan))
+        {
+            m_lifespansToAdd.push_back(entity);
+        }
+        m_components.add(r, lifespan, 0);
+    }
+}
+
+CShape & EntityManager::addShape(Entity entity)
+{
+    return m_components.addShape(row(entity));
+}
+
+ComponentStore & EntityManager::components()
+{
+    return m_components;
+}
+
+void EntityManager::expireLifespans(EntityVec & expired)
+{
+    m_due.clear();
+    m_lifespans.advance(m_due);
+
+    // The wheel hands entries back in scheduling order, which a reloaded
+    // world cannot reproduce; row order is the same either way
+    size_t first = expired.size();
+    for (const auto& d : m_due)
+    {
+        if (isActive(d.entity))
+        {
+            expired.push_back(d.entity);
+        }
+    }
+    std::sort(expired.begin() + first, expired.end(), [this](Entity a, Entity b)
+    {
+        return row(a) < row(b);
+    });
+}
+
+uint32_t EntityManager::lifespanTick() const
+{
+    return m_lifespans.now();
+}
+
+void EntityManager::setLifespanTick(uint32_t tick)
+{
+    m_lifespans.reset(tick);
+    for (size_t r = 0; r < m_entities.size(); r++)
+    {
+        if (m_components.has(r, Components::Lifespan) && m_components.has(r, Components::Alive))
+        {
+            m_lifespans.schedule(m_entities[r], m_components.lifeExpiry[r]);
+        }
+    }
+}
+
+const EntityVec & EntityManager::getEntities() const
 {
     return m_entities;
 }
 
-const EntityVec & EntityManager::getEntities(const std::string & tag)
+const EntityVec & EntityManager::getEntities(TagId tag) const
+{
+    return m_tagEntities[tag];
+}
+
+const EntityVec & EntityManager::getEntities(const std::string & tag) const
 {   
-    return m_entityMap[tag];
-}
\ No newline at end of file
+    // Look up without registering the tag: asking about a tag nobody uses
+    // should not create an empty list for it
+    static const EntityVec none;
+    auto it = m_tagIds.find(tag);
+    return it == m_tagIds.end() ? none : m_tagEntities[it->second];
+}
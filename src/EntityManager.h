@@ -1,31 +1,183 @@
 #pragma once
 
 #include <vector>
-#include <map>
-#include <memory>
+#include <unordered_map>
 #include <string>
 #include "Entity.h"
+#include "ComponentStore.h"
+#include "TimingWheel.h"
+#include "SpatialHash.h"
 
-using EntityVec = std::vector<std::shared_ptr<Entity>>;
-using EntityMap = std::map<std::string, EntityVec>;
+using EntityVec = std::vector<Entity>;
+
+class Prefab;
+
+// Tags are interned to small integers: each distinct tag string gets the next
+// id the first time it is seen, and keeps it for the manager's lifetime
+using TagId = uint16_t;
+
+// Where the world's memory goes, from EntityManager::memory()
+struct WorldMemory
+{
+    std::vector<Memory::Usage> components;  // by component type, see ComponentStore::memory()
+    std::vector<Memory::Usage> tags;        // by tag: its entities' rows, slots and list entries
+    std::vector<Memory::Usage> bookkeeping; // entity lists, slot table, lifespan wheel
+};
 
 class EntityManager
 {
-    EntityVec   m_entities;
-    EntityVec   m_entitiesToAdd;
-    EntityMap   m_entityMap;
-    size_t      m_totalEntities = 0;
+    // One slot per live entity. Unused slots form a free list through 'next'.
+    struct Slot
+    {
+        uint32_t    generation = 0;
+        uint32_t    row = 0;            // component row while in use
+        uint32_t    next = NO_SLOT;     // next free slot while unused
+        uint32_t    tagIndex = 0;       // position in its tag's entity list once committed
+        TagId       tag = 0;
+        bool        active = false;
+    };
+
+    static const uint32_t NO_SLOT = 0xFFFFFFFFu;
 
-    std::shared_ptr<Entity> createEntity(const size_t id, const std::string& tag);
-    void removeDeadEntities(EntityVec & vec);
+    // One tag's positions for spatial queries, rebuilt on demand
+    struct TagGrid
+    {
+        SpatialHash grid;               // items are positions in the tag's list
+        uint64_t    version = ~0ull;    // m_positionsVersion it was built at
+    };
+
+    EntityVec           m_entities;
+    EntityVec           m_entitiesToAdd;
+    EntityVec           m_destroyed;    // destroyed since the last update(), removed by it
+    std::vector<EntityVec> m_tagEntities; // committed entities by TagId
+    std::vector<std::string> m_tagNames;  // by TagId
+    std::unordered_map<std::string, TagId> m_tagIds;
+    ComponentStore      m_components;   // row i belongs to m_entities[i] (pending entities follow)
+    TimingWheel         m_lifespans;    // committed entities by lifeExpiry
+    EntityVec           m_lifespansToAdd; // pending entities given a lifespan, scheduled on commit
+    std::vector<TimingWheel::Entry> m_due;
+    std::vector<Slot>   m_slots;
+    uint32_t            m_freeSlot = NO_SLOT;
+    size_t              m_slotGrows = 0;
+    std::vector<TagGrid> m_tagGrids;    // by TagId, grown on first query
+    uint64_t            m_positionsVersion = 0;
+    float               m_queryCellSize = 64.0f;
+    std::vector<std::pair<float, uint32_t>> m_nearest; // nearest()'s candidates: distance squared, list position
+
+    Entity createEntity(TagId tag, const ComponentStore * prefab = nullptr);   // row 0 of prefab, if given
+    void releaseSlot(uint32_t slot);
+    void removeEntity(Entity entity);
+    SpatialHash & tagGrid(TagId tag);   // the tag's index, rebuilt first if stale
 
 public:
     EntityManager();
 
     void update();
+    void clear();                       // remove every entity; all handles become stale
+    void reserve(size_t entities);      // size the pools up front so spawning never allocates; grows geometrically
+
+    PoolStats entityPool() const;
+    PoolStats componentPool() const;
+    void memory(WorldMemory & out) const;   // replaces out's contents; allocates, so not per tick
+
+    TagId tagId(const std::string & tag);   // interns the tag if it is new
+    const std::string & tagName(TagId tag) const;
+    size_t tagCount() const;                // ids run from 0 to tagCount() - 1
+
+    // Reorders a tag's list to the entities at the given rows, e.g. to restore
+    // a saved world exactly. The rows must be exactly the tag's committed
+    // entities; otherwise nothing changes and it returns false.
+    bool setTagOrder(TagId tag, const std::vector<uint32_t> & rows);
+
+    Entity addEntity(TagId tag);
+    Entity addEntity(const std::string & tag);
+
+    // A new entity with the prefab's tag and a copy of its components (see
+    // Prefab). Pending until update(), like addEntity().
+    Entity instantiate(const Prefab & prefab);
+
+    template <typename C>
+    void addComponent(Entity entity, const C & component)
+    {
+        m_components.add(row(entity), component);
+    }
+
+    // Lifespans count simulation ticks (see expireLifespans) from the moment
+    // the entity is committed, so an entity added during a tick is not aged
+    // until the next one
+    void addComponent(Entity entity, const CLifespan & lifespan);
+
+    // Sets the shape bit and returns the row's pooled shape, so spawn code can
+    // set() it in place instead of copying in a freshly built sf::CircleShape
+    CShape & addShape(Entity entity);
+
+    bool isValid(Entity entity) const;  // handle still refers to an entity in the manager
+    bool isActive(Entity entity) const; // valid and not destroyed
+    void destroy(Entity entity);
+    TagId tagOf(Entity entity) const;
+    const std::string & tag(Entity entity) const;
+    size_t row(Entity entity) const;    // component row, only meaningful for valid handles
+
+    ComponentStore & components();
+
+    // Advances the lifespan clock by one tick and appends the live entities
+    // whose lifespan ran out on it, in row order. Only those entities are
+    // visited, not every entity with a lifespan.
+    void expireLifespans(EntityVec & expired);
+    uint32_t lifespanTick() const;          // ticks expireLifespans() has run
+    void setLifespanTick(uint32_t tick);    // restart the clock, rescheduling every lifeExpiry, e.g. after a load
+
+    // Calls fn(entity, refs...) for every live, committed entity holding all
+    // of Cs, with one typed reference per component (see ComponentAccess),
+    // e.g. view<CTransform, CLifespan>([](Entity e, TransformRef t, LifespanRef l) { ... }).
+    // Rows are picked by a single compare against a mask computed at compile
+    // time, so the loop needs no per-component checks. fn may add or destroy
+    // entities; added ones are not visited, destroyed ones are skipped.
+    template <typename... Cs, typename F>
+    void view(F && fn)
+    {
+        const uint8_t bits = componentMask<Cs...>() | Components::Alive;
+        for (size_t row = 0; row < m_entities.size(); row++)
+        {
+            if ((m_components.mask[row] & bits) == bits)
+            {
+                fn(m_entities[row], ComponentAccess<Cs>::get(m_components, row)...);
+            }
+        }
+    }
+
+    // The same, restricted to entities with the given tag, in tag-list order.
+    // The list is looked up again every step, as fn interning a new tag may
+    // move it.
+    template <typename... Cs, typename F>
+    void view(TagId tag, F && fn)
+    {
+        const uint8_t bits = componentMask<Cs...>() | Components::Alive;
+        for (size_t i = 0; i < m_tagEntities[tag].size(); i++)
+        {
+            Entity entity = m_tagEntities[tag][i];
+            size_t row = m_slots[entity.slot()].row;
+            if ((m_components.mask[row] & bits) == bits)
+            {
+                fn(entity, ComponentAccess<Cs>::get(m_components, row)...);
+            }
+        }
+    }
 
-    std::shared_ptr<Entity> addEntity(const std::string & tag);
+    // Spatial queries over committed, live entities with a CTransform, by
+    // center distance. Each tag has its own grid, built from the positions
+    // when the tag is first queried after they may have changed: update()
+    // counts as a change, and so must every system that moves entities, by
+    // calling positionsChanged(). A query then only visits the cells around
+    // pos. Both replace out's contents, allocating only if it is too small.
+    void setQueryCellSize(float cellSize);  // about the usual query radius; takes effect on the next rebuild
+    void positionsChanged();
+    size_t queryRadius(const Vec2 & pos, float radius, TagId tag, EntityVec & out); // in no particular order
+    size_t nearest(const Vec2 & pos, TagId tag, size_t k, EntityVec & out);         // the k nearest, nearest first
 
-    const EntityVec & getEntities();
-    const EntityVec & getEntities(const std::string & tag);
-};
\ No newline at end of file
+    // Entity lists are in no particular order: removal swaps the last entry
+    // into the hole. Entities added since the last update() are not listed yet.
+    const EntityVec & getEntities() const;
+    const EntityVec & getEntities(TagId tag) const;
+    const EntityVec & getEntities(const std::string & tag) const; // empty for unknown tags
+};
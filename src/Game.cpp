@@ -1,25 +1,56 @@
 #include "Game.h"
 #include "EntityManager.h"
+#include "Kernels.h"
+#include "Collision.h"
 
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <cmath>
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
 
-#include <cstdlib>  // For rand() and RAND_MAX
 #include <ctime>    // For time()
 
-int getRandomColorComponent() 
+// Rows per ThreadPool chunk: enough work per chunk to outweigh handing it to
+// another thread (moving or publishing a row costs a few ns, tessellating
+// one ~100 ns)
+const size_t MOVE_GRAIN = 4096;
+const size_t PUBLISH_GRAIN = 2048;
+const size_t RENDER_GRAIN = 256;
+
+Game::Game(const std::string & config, bool headless)
+    : m_headless(headless)
 {
-    return rand() % 256;
+    m_playerTag = m_entities.tagId("player");
+    m_enemyTag = m_entities.tagId("enemy");
+    m_bulletTag = m_entities.tagId("bullet");
+
+    // Read and initialize with configuration values
+    std::ifstream fin(config);
+    if (fin)
+    {
+        init(fin);
+    } else
+    {
+        std::cout << "no config file \n";
+    }
+    m_pool.start(m_threads);
 }
 
-Game::Game(const std::string & config)
+Game::Game(std::istream & config, size_t threads)
+    : m_headless(true)
 {
+    m_playerTag = m_entities.tagId("player");
+    m_enemyTag = m_entities.tagId("enemy");
+    m_bulletTag = m_entities.tagId("bullet");
     init(config);
+    m_pool.start(threads);
 }
 
-void Game::readConfig(std::string & head, std::ifstream & fin)
+void Game::readConfig(std::string & head, std::istream & fin)
 {
     if (head == "Window")
     {
@@ -28,6 +59,13 @@ void Game::readConfig(std::string & head, std::ifstream & fin)
 
         fin >> wWidth >> wHeight >> wFramelimit >> wScreenMode;
 
+        // The simulation only ever sees the world size; the window is optional
+        m_worldSize = Vec2(wWidth, wHeight);
+        if (m_headless)
+        {
+            return;
+        }
+
         // set up default window parameters
         if (wScreenMode == 1) // Assuming 1 represents full screen mode
         {
@@ -50,10 +88,18 @@ void Game::readConfig(std::string & head, std::ifstream & fin)
 
         fin >> fPath >> size >> fR >> fG >> fB;
 
+        if (m_headless)
+        {
+            return;
+        }
+
         m_font.loadFromFile(fPath);
         m_text.setFont(m_font);
         m_text.setCharacterSize(size);
         m_text.setFillColor(sf::Color(fR, fG, fB));
+        m_profileText.setFont(m_font);
+        m_profileText.setCharacterSize(size / 2 > 8 ? size / 2 : 8);
+        m_profileText.setFillColor(sf::Color(fR, fG, fB));
 
     } else if (head == "Player")
     {
@@ -96,20 +142,22 @@ void Game::readConfig(std::string & head, std::ifstream & fin)
             >> m_bulletConfig.OT 
             >> m_bulletConfig.V 
             >> m_bulletConfig.L;
+    } else if (head == "Simulation")
+    {
+        // Optional: simulation ticks per second, and the most ticks one pass
+        // of run() may run to catch up (the render rate is the Window FL)
+        fin >> m_tickRate >> m_maxTicksPerFrame;
+        m_tickRate = std::max(m_tickRate, 1.0f);
+        m_maxTicksPerFrame = std::max(m_maxTicksPerFrame, 1);
+    } else if (head == "Threads")
+    {
+        // Optional: threads for the per-entity systems, 0 for one per core
+        fin >> m_threads;
     }
 }
 
-void Game::init(const std::string & path)
+void Game::init(std::istream & fin)
 {
-    // Read and initialize with configuration values
-    std::ifstream fin(path);
-
-    if (!fin)
-    {
-        std::cout << "no config file \n";
-        return;
-    }
-    
     std::string tempHead;
 
     while (fin >> tempHead)
@@ -117,40 +165,235 @@ void Game::init(const std::string & path)
         readConfig(tempHead, fin);
     }
 
+    // Spatial queries mostly look for enemies around a point; cells about
+    // an enemy across keep a query to a few cells
+    m_entities.setQueryCellSize(2.0f * m_enemyConfig.CR);
+
+    buildPrefabs();
     spawnPlayer();
     m_entities.update();
 
     // Seed the random number generator at the start of the program
-    std::srand(static_cast<unsigned int>(std::time(0)));
+    setSeed(static_cast<unsigned int>(std::time(0)));
 }
 
 void Game::run()
 {
-    // TODO: add pause functionality in here
-    //       some systems should function while paused (rendering)
-    //       some systems shouldn't (movement / input)
-    
+    // The simulation advances in fixed ticks of 1 / m_tickRate seconds,
+    // independent of the render rate: each pass runs as many ticks as real
+    // time calls for. Velocities and spawn intervals stay in per-tick units.
+    //
+    // Drawing runs on its own thread (renderLoop), so a display() blocked on
+    // vsync or the frame limit never holds up a tick, and the other way round.
+    // After its ticks each pass publishes a RenderFrame, then sleeps until
+    // the next tick is due.
+    const float tick = 1.0f / m_tickRate;
+    float accumulator = 0.0f;
+    sf::Clock clock;
+
+    // The window's GL context moves to the render thread; events are still
+    // polled here, on the thread that created the window, as SFML requires
+    m_window.setActive(false);
+    m_renderPool.start(m_pool.size());
+    m_rendering = true;
+    publishRender(RenderFrame::now());
+    m_renderThread = std::thread(&Game::renderLoop, this);
+
     while (m_running)
     {
-        if (!m_paused)    
+        float elapsed = clock.restart().asSeconds();
+
+        // Input is polled once per pass; sMovement reads the held keys on
+        // every tick
+        sUserInput();
+
+        int ticks = 0;
+        if (!m_paused)
+        {
+            accumulator += elapsed;
+
+            while (accumulator >= tick && ticks < m_maxTicksPerFrame)
+            {
+                simulate();
+                accumulator -= tick;
+                ticks++;
+            }
+
+            // Too far behind to catch up: drop the backlog and let the game
+            // run slow rather than spend ever longer simulating each pass
+            if (accumulator >= tick)
+            {
+                accumulator = std::fmod(accumulator, tick);
+            }
+        }
+
+        // The newest tick fell due 'accumulator' seconds ago; the renderer
+        // blends towards it from there. While paused that stays put, so the
+        // picture freezes where it was.
+        if (ticks > 0 || m_paused)
         {
-            m_entities.update();
-
-            sEnemySpawner();
-            sMovement();
-            sLifespan();
-            sCollision();
-            sUserInput();
-            sRender();
-
-            // increment the current frame
-            // may need to be moved when pause implemented
-            m_currentFrame++;
-        } else {
-            sUserInput();
-            sRender();
+            publishRender(RenderFrame::now() - accumulator);
+
+            // The profiler's frames are this thread's passes. The render
+            // thread records meanwhile; each of its draws counts towards the
+            // first pass to end after it, so a pass may hold zero or several.
+            PROFILE_END_FRAME();
+            Memory::endFrame();
         }
+
+        std::this_thread::sleep_for(std::chrono::duration<float>(tick - accumulator));
+    }
+
+    m_rendering = false;
+    m_renderThread.join();
+    m_window.setActive(true);
+    printMemory(std::cout);
+}
+
+void Game::simulate()
+{
+    // Spawns and destroys recorded by the input and the systems take effect
+    // at the two sync points: before update() commits this tick's spawns, and
+    // at the end of the tick, so nothing is left pending between ticks
+    applyInput();
+    applyCommands();
+
+    {
+        PROFILE_SCOPE("update");
+        m_entities.update();
+    }
+
+    sEnemySpawner();
+    sMovement();
+    sLifespan();
+    sCollision();
+    applyCommands();
+
+    m_currentFrame++;
+    if (m_stream.isOpen())
+    {
+        publishStream();
+    }
+}
+
+void Game::applyCommands()
+{
+    PROFILE_SCOPE("applyCommands");
+    m_commands.playback(m_entities);
+}
+
+void Game::runHeadless(int frames)
+{
+    // Step the simulation systems back to back with no window or rendering,
+    // as fast as the CPU allows (input comes from a replay log, if any)
+    sf::Clock clock;
+    for (int i = 0; i < frames; i++)
+    {
+        simulate();
+        PROFILE_END_FRAME();
+        Memory::endFrame();
     }
+    report(frames, clock.getElapsedTime().asSeconds());
+}
+
+void Game::step()
+{
+    simulate();
+}
+
+GameSummary Game::summary() const
+{
+    GameSummary s;
+    s.score = m_score;
+    s.ticks = m_currentFrame;
+    s.entities = m_entities.getEntities().size();
+    s.enemies = m_entities.getEntities(m_enemyTag).size();
+    s.bullets = m_entities.getEntities(m_bulletTag).size();
+    return s;
+}
+
+void Game::report(int frames, float seconds)
+{
+    std::cout << "threads:  " << m_pool.size() << "\n";
+    std::cout << "frames:   " << frames << "\n";
+    std::cout << "seconds:  " << seconds << "\n";
+    std::cout << "fps:      " << (seconds > 0.0f ? frames / seconds : 0.0f) << "\n";
+    std::cout << "entities: " << m_entities.getEntities().size() << "\n";
+    std::cout << "enemies:  " << m_entities.getEntities(m_enemyTag).size() << "\n";
+    std::cout << "bullets:  " << m_entities.getEntities(m_bulletTag).size() << "\n";
+    std::cout << "score:    " << m_score << "\n";
+
+    PoolStats entities = m_entities.entityPool();
+    PoolStats components = m_entities.componentPool();
+    std::cout << "entity pool:    " << entities.live << " live, " << entities.highWater
+              << " high-water, " << entities.capacity << " capacity, " << entities.grows << " grows\n";
+    std::cout << "component pool: " << components.live << " live, " << components.highWater
+              << " high-water, " << components.capacity << " capacity, " << components.grows << " grows\n";
+
+    if (m_stream.isOpen())
+    {
+        WorldStream::Stats stream = m_stream.stats();
+        std::cout << "stream:         " << stream.published << " published, " << stream.sent << " sent, "
+                  << stream.dropped << " dropped, " << stream.bytes << " bytes, " << stream.clients << " clients\n";
+    }
+
+#if PROFILER_ENABLED
+    std::cout << "per frame, last 128 frames:\n";
+    printProfile(std::cout);
+#endif
+    printMemory(std::cout);
+}
+
+void Game::printProfile(std::ostream & out)
+{
+    // Systems take microseconds at typical entity counts, so print in us
+    Profiler::stats(m_profileStats);
+    out << std::fixed << std::setprecision(1);
+    for (auto& st : m_profileStats)
+    {
+        out << std::left << std::setw(16) << st.name << std::right
+            << " min " << std::setw(8) << st.minMs * 1000.0
+            << "  avg " << std::setw(8) << st.avgMs * 1000.0
+            << "  p99 " << std::setw(8) << st.p99Ms * 1000.0 << " us\n";
+    }
+    out << std::defaultfloat;
+}
+
+static void printUsage(std::ostream & out, const char* title, const std::vector<Memory::Usage> & usage)
+{
+    out << std::left << std::setw(20) << title << std::right << std::setw(10) << "count"
+        << std::setw(12) << "KiB" << std::setw(14) << "reserved KiB" << "\n";
+    for (const auto& u : usage)
+    {
+        out << "  " << std::left << std::setw(18) << u.name << std::right
+            << std::setw(10) << u.count
+            << std::setw(12) << u.bytes / 1024.0
+            << std::setw(14) << u.reserved / 1024.0 << "\n";
+    }
+}
+
+void Game::printMemory(std::ostream & out)
+{
+    out << std::fixed << std::setprecision(1);
+    if (Memory::tracking())
+    {
+        // Steady state is the median over the last 128 frames, so a one-off
+        // spike shows up in the peak without moving it
+        Memory::Counters heap = Memory::counters();
+        Memory::FrameStats frames = Memory::frameStats();
+        out << "heap:           " << heap.liveBytes / 1024.0 << " KiB live, "
+            << frames.steadyBytes / 1024.0 << " KiB steady, "
+            << heap.peakBytes / 1024.0 << " KiB peak, "
+            << heap.allocations - heap.frees << " blocks\n";
+        out << "allocations:    " << frames.allocsPerFrame << " per frame (peak "
+            << frames.peakAllocsPerFrame << "), " << frames.bytesPerFrame << " B per frame\n";
+    }
+
+    m_entities.memory(m_worldMemory);
+    printUsage(out, "component", m_worldMemory.components);
+    printUsage(out, "tag", m_worldMemory.tags);
+    printUsage(out, "bookkeeping", m_worldMemory.bookkeeping);
+    out << std::defaultfloat;
 }
 
 void Game::setPaused()
@@ -158,29 +401,154 @@ void Game::setPaused()
     m_paused = !m_paused;
 }
 
-void Game::spawnPlayer()
+void Game::setSeed(unsigned int seed)
 {
-    // We create every entity by calling EntityManager.addEntity(tag)
-    // This returns a std::shared_ptr<Entity>, so we use 'auto' to save typing
-    auto entity = m_entities.addEntity("player");
+    m_seed = seed;
+    m_rng.seed(seed);
+}
 
-    // Entity's transform component using configuration variables
-    Vec2 pos = {m_window.getSize().x / 2.0f, m_window.getSize().y / 2.0f};
-    Vec2 vel = {m_playerConfig.S, m_playerConfig.S};
-    entity->cTransform = std::make_shared<CTransform>(pos, vel, 0.0f);
-    
+bool Game::record(const std::string & path)
+{
+    // The log starts with the tick and random state, so a replay can check it
+    // starts from the same world and draws the same random numbers
+    InputLogStart start;
+    start.seed = m_seed;
+    start.tick = static_cast<uint32_t>(m_currentFrame);
+    start.rngState = m_rng.state();
+    start.rngIncrement = m_rng.increment();
+    if (!m_recorder.open(path, start))
+    {
+        std::cout << "could not write input log " << path << "\n";
+        return false;
+    }
+    return true;
+}
 
-    // Entity's shape component using configuration variables
-    entity->cShape = std::make_shared<CShape>(m_playerConfig.SR, m_playerConfig.V, 
-                                              sf::Color(m_playerConfig.FR, m_playerConfig.FG, m_playerConfig.FB),
-                                              sf::Color(m_playerConfig.OR, m_playerConfig.OG, m_playerConfig.OB),
-                                              m_playerConfig.OT);
+bool Game::replay(const std::string & path)
+{
+    if (!m_replay.open(path))
+    {
+        std::cout << "no input log " << path << "\n";
+        return false;
+    }
 
-    // Add an input component to the player so that we can use inputs
-    entity->cInput = std::make_shared<CInput>();
+    // A log from a fresh game fits any fresh game, whatever it was seeded
+    // with. One recorded later, e.g. after loading a snapshot, needs that
+    // same world: the same tick and the random state it had then.
+    const InputLogStart& start = m_replay.start();
+    if (start.tick != static_cast<uint32_t>(m_currentFrame)
+        || (start.tick > 0 && (start.rngState != m_rng.state() || start.rngIncrement != m_rng.increment())))
+    {
+        std::cout << "input log " << path << " was recorded from another world, at tick " << start.tick
+                  << "; load the snapshot it started from\n";
+        m_replay.close();
+        return false;
+    }
+    m_seed = start.seed;
+    m_rng.restore(start.rngState, start.rngIncrement);
+    return true;
+}
 
-    // Add the collision component
-    entity->cCollision = std::make_shared<CCollision>(m_playerConfig.CR);
+void Game::runReplay()
+{
+    runHeadless(static_cast<int>(m_replay.ticks()));
+}
+
+void Game::applyInput()
+{
+    CInput& input = m_entities.components().input[m_entities.row(m_player)];
+    if (m_replay.isOpen())
+    {
+        // The log stands in for the window. Its pause presses are only for
+        // the record: ticks spent paused were never logged.
+        m_replay.next(m_tickInput);
+        input.up = (m_tickInput.keys & TickInput::Up) != 0;
+        input.down = (m_tickInput.keys & TickInput::Down) != 0;
+        input.left = (m_tickInput.keys & TickInput::Left) != 0;
+        input.right = (m_tickInput.keys & TickInput::Right) != 0;
+    } else
+    {
+        m_tickInput.keys = (input.up ? TickInput::Up : 0)
+                         | (input.down ? TickInput::Down : 0)
+                         | (input.left ? TickInput::Left : 0)
+                         | (input.right ? TickInput::Right : 0);
+    }
+
+    if (m_recorder.isOpen())
+    {
+        m_recorder.write(m_tickInput);
+    }
+
+    // Clicks land at the start of the tick after them, live or replayed
+    for (auto& click : m_tickInput.clicks)
+    {
+        if (click.button == TickInput::Fire)
+        {
+            spawnBullet(m_player, Vec2(click.x, click.y));
+        } else
+        {
+            spawnSpecialWeapon(m_player);
+        }
+    }
+    m_tickInput.clear();
+}
+
+void Game::buildPrefabs()
+{
+    // Everything a spawn shares with the others of its kind, so spawning
+    // copies a prepared row instead of rebuilding each component
+    m_playerPrefab = Prefab(m_playerTag);
+    m_playerPrefab.add(CTransform(Vec2(0.0f, 0.0f), Vec2(0.0f, 0.0f), 0.0f, 1.0f));
+    m_playerPrefab.addShape().set(m_playerConfig.SR, m_playerConfig.V,
+                                  sf::Color(m_playerConfig.FR, m_playerConfig.FG, m_playerConfig.FB),
+                                  sf::Color(m_playerConfig.OR, m_playerConfig.OG, m_playerConfig.OB),
+                                  m_playerConfig.OT);
+    m_playerPrefab.add(CInput());
+    m_playerPrefab.add(CCollision(m_playerConfig.CR));
+
+    m_bulletPrefab = Prefab(m_bulletTag);
+    m_bulletPrefab.add(CTransform(Vec2(0.0f, 0.0f), Vec2(0.0f, 0.0f), 0.0f));
+    m_bulletPrefab.addShape().set(static_cast<float>(m_bulletConfig.SR), m_bulletConfig.V,
+                                  sf::Color(m_bulletConfig.FR, m_bulletConfig.FG, m_bulletConfig.FB),
+                                  sf::Color(m_bulletConfig.OR, m_bulletConfig.OG, m_bulletConfig.OB),
+                                  static_cast<float>(m_bulletConfig.OT));
+    m_bulletPrefab.add(CCollision(m_bulletConfig.CR));
+    m_bulletPrefab.add(CLifespan(m_bulletConfig.L));
+
+    // Enemies differ in their point count, so there is a prefab per count;
+    // each spawn sets its own fill colour
+    sf::Color outline(m_enemyConfig.OR, m_enemyConfig.OG, m_enemyConfig.OB);
+    m_enemyPrefabs.clear();
+    m_smallEnemyPrefabs.clear();
+    for (int points = m_enemyConfig.VMIN; points <= m_enemyConfig.VMAX; points++)
+    {
+        Prefab enemy(m_enemyTag);
+        enemy.add(CTransform(Vec2(0.0f, 0.0f), Vec2(0.0f, 0.0f), 0.0f, 3.0f));
+        enemy.add(CBounce());
+        enemy.addShape().set(m_enemyConfig.SR, points, sf::Color::Black, outline, m_playerConfig.OT);
+        enemy.add(CCollision(m_enemyConfig.CR));
+        m_enemyPrefabs.push_back(enemy);
+
+        Prefab small(m_enemyTag);
+        small.add(CTransform(Vec2(0.0f, 0.0f), Vec2(0.0f, 0.0f), 0.0f, 5.0f));
+        small.add(CBounce());
+        small.addShape().set(m_enemyConfig.SR / 4.0f, points, sf::Color::Black, outline, m_playerConfig.OT);
+        small.add(CCollision(m_enemyConfig.CR / 4));
+        small.add(CLifespan(m_enemyConfig.L));
+        m_smallEnemyPrefabs.push_back(small);
+    }
+}
+
+void Game::spawnPlayer()
+{
+    // We create every entity from a prefab (or EntityManager.addEntity(tag))
+    // This returns an Entity handle, so we use 'auto' to save typing
+    auto entity = m_entities.instantiate(m_playerPrefab);
+
+    // The prefab holds every component; the player starts in the middle of
+    // the world, which only the instance knows. It is steered by input in
+    // sMovement, so its transform velocity stays zero.
+    m_entities.components().setPos(m_entities.row(entity), Vec2(m_worldSize.x / 2.0f, m_worldSize.y / 2.0f));
 
     // Since we want this Entity to be our player, set our Game's player variable to be this Entity
     // This goes slightly against the EntityManager paradigm, but we use the player so much it's worth it
@@ -190,150 +558,196 @@ void Game::spawnPlayer()
 // spawn an enemy at a random position
 void Game::spawnEnemy()
 {
-    // TODO: make sure the enemy is spawned properly with the m_enemyConfig variables
-    //       the enemy must be spawned completely within the bounds of the window
-
-    // Randomizing spawning position / speed / shape
-    int x_min = 0;
-    int x_max = m_window.getSize().x;
-    int y_min = 0;
-    int y_max = m_window.getSize().y;
-
-    float randpos_x = static_cast<float>(x_min + (rand() % (1 + x_max - x_min)));
-    float randpos_y = static_cast<float>(y_min + (rand() % (1 + y_max - y_min)));
-    float randSpeed_x = (rand() / (float)RAND_MAX) * (m_enemyConfig.SMAX - m_enemyConfig.SMIN) + m_enemyConfig.SMIN;
-    float randSpeed_y = (rand() / (float)RAND_MAX) * (m_enemyConfig.SMAX - m_enemyConfig.SMIN) + m_enemyConfig.SMIN;
-
-    // Randomly decide if the speed should be negative
-    if (rand() % 2 == 0) randSpeed_x = -randSpeed_x;
-    if (rand() % 2 == 0) randSpeed_y = -randSpeed_y;
+    spawnEnemyWave(1);
+}
 
-    int rand_V = m_enemyConfig.VMIN  + (rand() % (1 + m_enemyConfig.VMAX - m_enemyConfig.VMIN));
-    int randR = getRandomColorComponent();
-    int randG = getRandomColorComponent();
-    int randB = getRandomColorComponent();
+// spawn n enemies at random positions, completely within the world
+void Game::spawnEnemyWave(size_t n)
+{
+    // Size the pools for the whole wave at once, so a big wave grows storage
+    // at most once instead of repeatedly while it spawns. Within capacity,
+    // e.g. for a single enemy, this costs a compare.
+    size_t needed = m_entities.entityPool().live + n;
+    if (needed > m_entities.entityPool().capacity)
+    {
+        m_entities.reserve(needed);
+    }
 
-    auto entity = m_entities.addEntity("enemy");
+    // Draw every random number the wave needs in one go: RANDOM_FIELDS raw
+    // outputs per enemy, laid out field by field so each field is contiguous
+    const size_t RANDOM_FIELDS = 7;
+    m_waveBits.resize(n * RANDOM_FIELDS);
+    m_rng.fill(m_waveBits.data(), m_waveBits.size());
+    const uint32_t* bitsX = &m_waveBits[0 * n];
+    const uint32_t* bitsY = &m_waveBits[1 * n];
+    const uint32_t* bitsSpeedX = &m_waveBits[2 * n];
+    const uint32_t* bitsSpeedY = &m_waveBits[3 * n];
+    const uint32_t* bitsSigns = &m_waveBits[4 * n];
+    const uint32_t* bitsPoints = &m_waveBits[5 * n];
+    const uint32_t* bitsColor = &m_waveBits[6 * n];
+
+    // Turn them into spawn parameters: straight-line, branch-free loops the
+    // compiler can vectorise
+    m_wave.resize(n);
+    uint32_t spanX = static_cast<uint32_t>(m_worldSize.x) + 1;
+    uint32_t spanY = static_cast<uint32_t>(m_worldSize.y) + 1;
+    float minSpeed = m_enemyConfig.SMIN;
+    float speedSpan = m_enemyConfig.SMAX - m_enemyConfig.SMIN;
+    uint32_t pointSpan = static_cast<uint32_t>(m_enemyConfig.VMAX - m_enemyConfig.VMIN + 1);
+    for (size_t i = 0; i < n; i++)
+    {
+        m_wave.x[i] = static_cast<float>(Random::below(bitsX[i], spanX));
+        m_wave.y[i] = static_cast<float>(Random::below(bitsY[i], spanY));
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        // Either direction on each axis: bit 0 and bit 1 flip the sign
+        float signX = 1.0f - 2.0f * static_cast<float>(bitsSigns[i] & 1);
+        float signY = 1.0f - 2.0f * static_cast<float>((bitsSigns[i] >> 1) & 1);
+        m_wave.vx[i] = signX * (minSpeed + speedSpan * Random::unit(bitsSpeedX[i]));
+        m_wave.vy[i] = signY * (minSpeed + speedSpan * Random::unit(bitsSpeedY[i]));
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        m_wave.points[i] = m_enemyConfig.VMIN + static_cast<int>(Random::below(bitsPoints[i], pointSpan));
+    }
 
-    Vec2 pos = {randpos_x, randpos_y};
-    Vec2 vel = {randSpeed_x, randSpeed_y};
-    entity->cTransform = std::make_shared<CTransform>(pos, vel, 0.0f);
+    // Each enemy is a copy of the prefab with its point count, given its own
+    // position, velocity and fill colour
+    ComponentStore& c = m_entities.components();
+    for (size_t i = 0; i < n; i++)
+    {
+        auto entity = m_entities.instantiate(m_enemyPrefabs[m_wave.points[i] - m_enemyConfig.VMIN]);
 
-    // Entity's shape component using configuration variables
-    entity->cShape = std::make_shared<CShape>(m_enemyConfig.SR, rand_V, 
-                                            sf::Color(randR, randG, randB),
-                                            sf::Color(m_enemyConfig.OR, m_enemyConfig.OG, m_enemyConfig.OB),
-                                            m_playerConfig.OT);
+        Vec2 pos = {m_wave.x[i], m_wave.y[i]};
+        Vec2 vel = {m_wave.vx[i], m_wave.vy[i]};
+        m_entities.addComponent(entity, CTransform(pos, vel, 0.0f, 3.0f));
 
-    entity->cCollision = std::make_shared<CCollision>(m_enemyConfig.CR);
+        // A random fill colour from the low three bytes of one draw
+        uint32_t rgb = bitsColor[i];
+        c.shape[m_entities.row(entity)].circle.setFillColor(sf::Color(rgb & 0xFF, (rgb >> 8) & 0xFF, (rgb >> 16) & 0xFF));
+    }
 
     m_lastEnemySpawnTime = m_currentFrame;
 }
 
 // spawns the small enemies when a big one (input entity e) explodes
-void Game::spawnSmallEnemies(std::shared_ptr<Entity> e)
+void Game::spawnSmallEnemies(Entity e)
 {
-    // TODO: spawn small enemies at the location of the input enemy e
-
     // when we create the smaller enemy, we have to read the values of the original enemy
     // - spawn a number of small enemies equal to the vertices of the original enemy
     // - set each small enemy to the same color as the original, half the size
     // - small enemies are worth double points of the original enemy
 
-    int radius = e->cShape->circle.getRadius();
-    size_t se_num = e->cShape->circle.getPointCount();
-    for (int i = 1; i <= se_num; i++)
+    // Recorded in m_commands, so this is safe mid-loop: nothing is added to
+    // the world until the next applyCommands()
+    ComponentStore& c = m_entities.components();
+    size_t row = m_entities.row(e);
+    const sf::CircleShape& circle = c.shape[row].circle;
+    float radius = circle.getRadius();
+    size_t se_num = circle.getPointCount();
+    sf::Color fill = circle.getFillColor();
+    sf::Color outline = circle.getOutlineColor();
+    float thickness = circle.getOutlineThickness();
+    Vec2 pos = c.pos(row);
+    Vec2 parentVel = c.velocity(row);
+
+    // A parent spawned under the current config has a matching prefab; one
+    // that does not (from a snapshot saved under another config, say) gets
+    // its small enemies built component by component
+    const Prefab* prefab = nullptr;
+    size_t index = se_num - m_enemyConfig.VMIN;
+    if (se_num >= static_cast<size_t>(m_enemyConfig.VMIN) && index < m_smallEnemyPrefabs.size())
     {
-        auto small_enemy = m_entities.addEntity("enemy");
+        const sf::CircleShape& small = m_smallEnemyPrefabs[index].components().shape[0].circle;
+        if (small.getRadius() == radius/4 && small.getOutlineColor() == outline && small.getOutlineThickness() == thickness)
+        {
+            prefab = &m_smallEnemyPrefabs[index];
+        }
+    }
 
-        Vec2 pos = e->cTransform->pos;
-        Vec2 vel = e->cTransform->velocity.spin(360.0f / se_num * i);
-        small_enemy->cTransform = std::make_shared<CTransform>(pos, vel, 0.0f);
+    for (size_t i = 1; i <= se_num; i++)
+    {
+        Vec2 vel = parentVel.spin(360.0f / se_num * i);
+        if (prefab)
+        {
+            auto small_enemy = m_commands.spawn(*prefab);
+            m_commands.add(small_enemy, CTransform(pos, vel, 0.0f, 5.0f));
+            m_commands.add(small_enemy, CommandBuffer::Fill{ fill });
+            continue;
+        }
+
+        auto small_enemy = m_commands.spawn(m_enemyTag);
+        m_commands.add(small_enemy, CTransform(pos, vel, 0.0f, 5.0f));
+        m_commands.add(small_enemy, CBounce());
 
         // Entity's shape component using configuration variables
-        small_enemy->cShape = std::make_shared<CShape>(e->cShape->circle.getRadius()/4,
-                                                e->cShape->circle.getPointCount(), 
-                                                e->cShape->circle.getFillColor(),
-                                                e->cShape->circle.getOutlineColor(),
-                                                e->cShape->circle.getOutlineThickness());
+        m_commands.add(small_enemy, CommandBuffer::ShapeSpec{ radius/4, static_cast<int>(se_num), fill, outline, thickness });
 
-        small_enemy->cCollision = std::make_shared<CCollision>(m_enemyConfig.CR/4);
+        m_commands.add(small_enemy, CCollision(m_enemyConfig.CR/4));
 
-        small_enemy->cLifespan = std::make_shared<CLifespan>(m_enemyConfig.L);
+        m_commands.add(small_enemy, CLifespan(m_enemyConfig.L));
     }
 }
 
-// spawns a bullet from a given entity to a target location
-void Game::spawnBullet(std::shared_ptr<Entity> entity, const Vec2 & target)
+// spawns a bullet from a given entity to a target location, at the next applyCommands()
+void Game::spawnBullet(Entity entity, const Vec2 & target)
 {
-    Vec2 start_pos = entity->cTransform->pos;
+    Vec2 start_pos = m_entities.components().pos(m_entities.row(entity));
     
-    auto bullet_entity = m_entities.addEntity("bullet");
+    // Shape, collision and lifespan come from the bullet prefab; only the
+    // transform is the bullet's own
+    auto bullet_entity = m_commands.spawn(m_bulletPrefab);
 
     Vec2 vel = (start_pos - target);
     vel.normalize();
     vel *= m_bulletConfig.S;
 
-    bullet_entity->cTransform = std::make_shared<CTransform>(start_pos, vel, 0.0f);
-    
-    // Entity's shape component using configuration variables
-    bullet_entity->cShape = std::make_shared<CShape>(m_bulletConfig.SR, m_bulletConfig.V, 
-                                              sf::Color(m_bulletConfig.FR, m_bulletConfig.FG, m_bulletConfig.FB),
-                                              sf::Color(m_bulletConfig.OR, m_bulletConfig.OG, m_bulletConfig.OB),
-                                              m_bulletConfig.OT);
-
-    // Entity's collision component
-    bullet_entity->cCollision = std::make_shared<CCollision>(m_bulletConfig.CR);
-
-    // Entity's lifespan component
-    bullet_entity->cLifespan = std::make_shared<CLifespan>(m_bulletConfig.L);
+    m_commands.add(bullet_entity, CTransform(start_pos, vel, 0.0f));
 }
 
-void Game::spawnSpecialWeapon(std::shared_ptr<Entity> entity)
+void Game::spawnSpecialWeapon(Entity entity)
 {
-    Vec2 origin = entity->cTransform->pos;
+    Vec2 origin = m_entities.components().pos(m_entities.row(entity));
     for (int i = 1; i <= 64; i++)
     {
         spawnBullet(entity, origin + Vec2(1,0).spin(360.0f / 64 * i));
     }
 }
 
-void Game::checkAndReverseVelocity(std::shared_ptr<Entity> entity)
-{
-    // Get the window size
-    float windowWidth = m_window.getSize().x;
-    float windowHeight = m_window.getSize().y;
-
-    // Get the entity's position and velocity
-    float& posX = entity->cTransform->pos.x;
-    float& posY = entity->cTransform->pos.y;
-    float& velX = entity->cTransform->velocity.x;
-    float& velY = entity->cTransform->velocity.y;
-
-    // Check and reverse velocity if the entity reaches the window boundaries
-    if (posX <= 0 || posX >= windowWidth)
-    {
-        velX = -velX;
-    }
-    if (posY <= 0 || posY >= windowHeight)
-    {
-        velY = -velY;
-    }
-}
-
 // System functions
 void Game::sMovement()
 {
+    PROFILE_SCOPE("sMovement");
+
+    ComponentStore& c = m_entities.components();
+
+    // Every entity first records where it was for render interpolation, then
+    // moves by its velocity, bounces off the world edges if it has CBounce,
+    // and spins. Only committed rows: entities spawned this tick are still
+    // pending and start moving next tick. Rows are independent, so chunks of
+    // them run in parallel.
+    float width = m_worldSize.x;
+    float height = m_worldSize.y;
+    m_pool.parallelFor(m_entities.getEntities().size(), MOVE_GRAIN, [&](size_t, size_t begin, size_t end)
+    {
+        PROFILE_SCOPE("sMovement chunk");
+        c.savePrevious(begin, end);
+        Kernels::move(c, begin, end, width, height);
+    });
+
     // Player movement control system
+    size_t pi = m_entities.row(m_player);
+    const CInput& input = c.input[pi];
 
     // Sample movement speed update
     float dx = 0.0f;
     float dy = 0.0f;
 
-    if (m_player->cInput->up) dy -= 1.0f;
-    if (m_player->cInput->down) dy += 1.0f;
-    if (m_player->cInput->left) dx -= 1.0f;
-    if (m_player->cInput->right) dx += 1.0f;
+    if (input.up) dy -= 1.0f;
+    if (input.down) dy += 1.0f;
+    if (input.left) dx -= 1.0f;
+    if (input.right) dx += 1.0f;
 
     // Normalize the direction vector
     float length = std::sqrt(dx * dx + dy * dy);
@@ -343,134 +757,154 @@ void Game::sMovement()
     }
 
     // Update the player's position
-    m_player->cTransform->pos.x += dx;
-    m_player->cTransform->pos.y += dy;
+    float &x = c.posX[pi];
+    float &y = c.posY[pi];
+    x += dx;
+    y += dy;
 
     // Boundary conditions
-    float &x = m_player->cTransform->pos.x;
-    float &y = m_player->cTransform->pos.y;
     if (x < m_playerConfig.SR) x = m_playerConfig.SR;
-    if (x > m_window.getSize().x - m_playerConfig.SR) x = m_window.getSize().x - m_playerConfig.SR;
+    if (x > m_worldSize.x - m_playerConfig.SR) x = m_worldSize.x - m_playerConfig.SR;
     if (y < m_playerConfig.SR) y = m_playerConfig.SR;
-    if (y > m_window.getSize().y - m_playerConfig.SR) y = m_window.getSize().y - m_playerConfig.SR;
-
-    // Bullet entity movements control
-    for (auto& e : m_entities.getEntities("bullet"))
-    {
-        if (e->isActive())
-        {
-            e->cTransform->pos.x -= e->cTransform->velocity.x;
-            e->cTransform->pos.y -= e->cTransform->velocity.y;
-            
-            // Destory if Lifespan has reached limit
-            if (e->cLifespan->remaining <= 0)
-            {
-                e->destroy();
-            }
-        }
-    }
+    if (y > m_worldSize.y - m_playerConfig.SR) y = m_worldSize.y - m_playerConfig.SR;
 
-    for (auto& e : m_entities.getEntities("enemy"))
-    {
-        if (e->isActive())
-        {
-            e->cTransform->pos.x -= e->cTransform->velocity.x;
-            e->cTransform->pos.y -= e->cTransform->velocity.y;
-            checkAndReverseVelocity(e);
-            if (e->cLifespan)
-            {
-                e->cTransform->angle += 5.0f;
-            } else
-            {
-                e->cTransform->angle += 3.0f;
-            }
-            
-        }
-    }
+    m_entities.positionsChanged();
 }
 
 void Game::sLifespan()
 {
-    // for all entities
-    //     if entity has no lifespan component, skip it
-    //     if entity has > 0 remaining lifespan, subtract 1
-    //     if it has lifespan and is alive
-    //         scale its alpha channel properly
-    //     if it has lifespan and its time is up
-    //         destroy the entity
-    for (auto& e : m_entities.getEntities())
+    PROFILE_SCOPE("sLifespan");
+
+    // Lifespans are stored as the tick they run out on, in a timing wheel, so
+    // nothing counts down: each tick only the entities expiring on it are
+    // visited. The fade alpha is derived from the tick when rendering.
+    m_expired.clear();
+    m_entities.expireLifespans(m_expired);
+    for (Entity e : m_expired)
     {
-        if (e->cLifespan)
-        {
-            if (e->cLifespan->remaining > 0)
-            {
-                auto lifespan = e->cLifespan;
-                
-                e->cLifespan->remaining -= 1;
-                
-                sf::Color fill_color = e->cShape->circle.getFillColor();
-                sf::Color outline_color = e->cShape->circle.getOutlineColor();
-                fill_color.a = 255 * lifespan->remaining / lifespan->total;
-                outline_color.a = 255 * lifespan->remaining / lifespan->total;
-
-                e->cShape->circle.setFillColor(fill_color);
-                e->cShape->circle.setOutlineColor(outline_color);
-            } else
-            {
-                e->destroy();
-            }
-        }
+        m_entities.destroy(e);
     }
-
 }
 
 void Game::sCollision()
 {
+    PROFILE_SCOPE("sCollision");
+
     // TODO: implement all proper collisions between entities
     //       be sure to use the collision radius, NOT the shape radius
-    for (auto& e : m_entities.getEntities("enemy"))
-    {   
-        Vec2& enemy_pos = e->cTransform->pos;
-        Vec2& player_pos = m_player->cTransform->pos;
+    ComponentStore& c = m_entities.components();
+    const EntityVec& bullets = m_entities.getEntities(m_bulletTag);
+    const EntityVec& enemies = m_entities.getEntities(m_enemyTag);
+
+    // Everything is tested along its path this tick, from its previous
+    // position to its current one, so a bullet cannot pass through an enemy
+    // between two ticks however fast it goes or however long the tick is.
+    // Wall bounces are taken as a straight line through the bounce.
+    //
+    // Broadphase: bucket every bullet by the middle of its path, so each
+    // enemy only tests the bullets in the cells around the middle of its own.
+    // A cell spans one enemy-plus-bullet reach, the bullet's counting half
+    // its travel, so a slow enemy's query touches a 3x3 block of cells.
+    float maxBulletReach = 0.0f;
+    m_entities.view<CTransform, CCollision>(m_bulletTag, [&](Entity b, TransformRef t, CollisionRef col)
+    {
+        Vec2 prev = c.lerpPos(m_entities.row(b), 0.0f);
+        maxBulletReach = std::max(maxBulletReach, col.radius + 0.5f * prev.dist(t.pos()));
+    });
+
+    m_bulletGrid.clear(m_enemyConfig.CR + maxBulletReach);
+    for (size_t i = 0; i < bullets.size(); i++)
+    {
+        m_bulletGrid.insert(i, c.lerpPos(m_entities.row(bullets[i]), 0.5f));
+    }
+    m_bulletGrid.build();
+
+    // Enemies destroyed earlier this tick (an expired lifespan, say) are
+    // skipped, so they can neither hit the player nor absorb a bullet. The
+    // loop is over the tag list rather than a view so each contact can name
+    // its enemy by list position.
+    m_contacts.clear();
+    size_t pi = m_entities.row(m_player);
+    for (size_t ei = 0; ei < enemies.size(); ei++)
+    {
+        Entity e = enemies[ei];
+        size_t row = m_entities.row(e);
+        if (!m_entities.isActive(e) || !c.has(row, Components::Transform | Components::Collision))
+        {
+            continue;
+        }
+        uint32_t enemyIndex = static_cast<uint32_t>(ei);
+        Vec2 enemyFrom = c.lerpPos(row, 0.0f);
+        Vec2 enemyTo = c.pos(row);
+        float enemyRadius = c.collisionRadius[row];
+
         // Player collision event with an enemy resets the position to center
-        if (player_pos.dist(enemy_pos) <= e->cCollision->radius + m_player->cCollision->radius)
+        float playerReach = enemyRadius + c.collisionRadius[pi];
+        if (Collision::sweptCircles(c.lerpPos(pi, 0.0f), c.pos(pi), enemyFrom, enemyTo, playerReach) >= 0.0f)
         {
-            if (e->isActive())
-            {
-                m_player->cTransform->pos.x = m_window.getSize().x / 2.0f;
-                m_player->cTransform->pos.y = m_window.getSize().y / 2.0f; 
-            }
+            c.setPos(pi, Vec2(m_worldSize.x / 2.0f, m_worldSize.y / 2.0f));
+            m_entities.positionsChanged();
         }
-        
-        for (auto& b : m_entities.getEntities("bullet"))
+
+        // Narrowphase: every live bullet whose path meets the enemy's
+        float query = enemyRadius + 0.5f * enemyFrom.dist(enemyTo) + maxBulletReach;
+        m_bulletGrid.query(c.lerpPos(row, 0.5f), query, [&](size_t i)
         {
-            Vec2& bullet_pos = b->cTransform->pos;
-            if (enemy_pos.dist(bullet_pos) <= e->cCollision->radius + b->cCollision->radius)
+            if (!m_entities.isActive(bullets[i]))
             {
-                if (b->isActive())
-                {
-                    e->destroy();
-                    b->destroy();
-                    if (e->cLifespan) 
-                    {
-                        m_score += 500;
-                        break;
-                        
-                    } else
-                    {
-                        spawnSmallEnemies(e);
-                        m_score += 200;
-                        break;
-                    }
-                }
+                return;
             }
-        }
+            size_t bi = m_entities.row(bullets[i]);
+            float time = Collision::sweptCircles(enemyFrom, enemyTo, c.lerpPos(bi, 0.0f), c.pos(bi),
+                                                 enemyRadius + c.collisionRadius[bi]);
+            if (time >= 0.0f)
+            {
+                m_contacts.push_back({ time, enemyIndex, static_cast<uint32_t>(i) });
+            }
+        });
     }
 
+    // Resolve contacts in the order they happened, so a bullet is spent on
+    // the first enemy in its path and an enemy taken by the first bullet to
+    // reach it; ties go to the earlier enemy, then the earlier bullet, in
+    // list order. Hits are recorded in m_commands, so the world does not
+    // change while it is being iterated.
+    std::sort(m_contacts.begin(), m_contacts.end(), [](const Contact & a, const Contact & b)
+    {
+        if (a.time != b.time) return a.time < b.time;
+        if (a.enemy != b.enemy) return a.enemy < b.enemy;
+        return a.bullet < b.bullet;
+    });
+
+    m_bulletHit.assign(bullets.size(), 0);
+    m_enemyHit.assign(enemies.size(), 0);
+    for (const Contact& contact : m_contacts)
+    {
+        if (m_enemyHit[contact.enemy] || m_bulletHit[contact.bullet])
+        {
+            continue;
+        }
+        m_enemyHit[contact.enemy] = 1;
+        m_bulletHit[contact.bullet] = 1;
+
+        Entity e = enemies[contact.enemy];
+        m_commands.destroy(e);
+        m_commands.destroy(bullets[contact.bullet]);
+        if (c.has(m_entities.row(e), Components::Lifespan))
+        {
+            m_score += 500;
+        } else
+        {
+            spawnSmallEnemies(e);
+            m_score += 200;
+        }
+    }
 }
 
 void Game::sEnemySpawner()
 {
+    PROFILE_SCOPE("sEnemySpawner");
+
     // TODO: code which implements enemy spawning should go here
     //
     //       (use m_currentFrame - m_lastEnemySpawnTime) to determine
@@ -482,55 +916,200 @@ void Game::sEnemySpawner()
     }
 }
 
-void Game::sRender()
+bool Game::stream(const std::string & path)
+{
+    std::vector<std::string> tags;
+    for (size_t t = 0; t < m_entities.tagCount(); t++)
+    {
+        tags.push_back(m_entities.tagName(static_cast<TagId>(t)));
+    }
+    return m_stream.open(path, tags);
+}
+
+void Game::publishStream()
+{
+    PROFILE_SCOPE("publishStream");
+
+    // Skipped, not waited for, while the sender is behind
+    StreamFrame* frame = m_stream.back();
+    if (!frame)
+    {
+        return;
+    }
+
+    ComponentStore& c = m_entities.components();
+    uint32_t lifespanTick = m_entities.lifespanTick();
+    frame->tick = static_cast<uint32_t>(m_currentFrame);
+    frame->entities.clear();
+    for (TagId tag : { m_playerTag, m_bulletTag, m_enemyTag })
+    {
+        m_entities.view<CTransform, CShape>(tag, [&](Entity e, TransformRef, CShape & shape)
+        {
+            size_t r = m_entities.row(e);
+            float angle = std::fmod(c.angle[r], 360.0f);
+            sf::Color fill = shape.circle.getFillColor();
+
+            StreamEntity s;
+            s.id = e.id();
+            s.tag = tag;
+            s.x = static_cast<int32_t>(std::lround(c.posX[r] * StreamEntity::POSITION_SCALE));
+            s.y = static_cast<int32_t>(std::lround(c.posY[r] * StreamEntity::POSITION_SCALE));
+            s.angle = static_cast<uint16_t>(static_cast<int32_t>((angle < 0 ? angle + 360.0f : angle) / 360.0f * 65536.0f));
+            s.rgba[0] = fill.r;
+            s.rgba[1] = fill.g;
+            s.rgba[2] = fill.b;
+            s.rgba[3] = static_cast<uint8_t>(fill.a * c.alpha(r, lifespanTick) / 255);
+            frame->entities.push_back(s);
+        });
+    }
+    m_stream.publish();
+}
+
+void Game::publishRender(double due)
 {
-    // TODO: change the code below to draw ALL of the entities
-    //       sample drawing of the player Entity that we have created
+    PROFILE_SCOPE("publishRender");
+
+    ComponentStore& c = m_entities.components();
+
+    // Draw the player, then bullets, then enemies (the same back-to-front
+    // order as drawing them one by one)
+    m_drawRows.clear();
+    m_drawRows.push_back(m_entities.row(m_player));
+    for (TagId tag : { m_bulletTag, m_enemyTag })
+    {
+        m_entities.view<CTransform, CShape>(tag, [&](Entity e, TransformRef, CShape &)
+        {
+            m_drawRows.push_back(m_entities.row(e));
+        });
+    }
+
+    RenderFrame& frame = m_renderBuffer.back();
+    frame.resize(m_drawRows.size());
+    uint32_t lifespanTick = m_entities.lifespanTick();
+    m_pool.parallelFor(m_drawRows.size(), PUBLISH_GRAIN, [&](size_t, size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            size_t r = m_drawRows[i];
+            const sf::CircleShape& shape = c.shape[r].circle;
+            frame.prevX[i] = c.prevX[r];
+            frame.prevY[i] = c.prevY[r];
+            frame.prevAngle[i] = c.prevAngle[r];
+            frame.x[i] = c.posX[r];
+            frame.y[i] = c.posY[r];
+            frame.angle[i] = c.angle[r];
+            frame.radius[i] = shape.getRadius();
+            frame.thickness[i] = shape.getOutlineThickness();
+            frame.points[i] = static_cast<uint32_t>(shape.getPointCount());
+
+            int alpha = c.alpha(r, lifespanTick);
+            frame.fill[i] = shape.getFillColor();
+            frame.outline[i] = shape.getOutlineColor();
+            frame.fill[i].a = static_cast<sf::Uint8>(frame.fill[i].a * alpha / 255);
+            frame.outline[i].a = static_cast<sf::Uint8>(frame.outline[i].a * alpha / 255);
+        }
+    });
+
+    frame.score = m_score;
+    frame.showProfile = m_showProfile;
+#if PROFILER_ENABLED
+    // Rolling per-system timings, shown under the score
+    if (m_showProfile)
+    {
+        std::ostringstream overlay;
+        printProfile(overlay);
+        if (Memory::tracking())
+        {
+            Memory::FrameStats heap = Memory::frameStats();
+            overlay << std::fixed << std::setprecision(1)
+                    << "heap " << Memory::counters().liveBytes / 1024.0 << " KiB, "
+                    << heap.allocsPerFrame << " allocs/frame\n";
+        }
+        frame.profile = overlay.str();
+    }
+#endif
+    frame.due = due;
+    frame.tickSeconds = 1.0f / m_tickRate;
+    m_renderBuffer.publish();
+}
+
+void Game::renderLoop()
+{
+    m_window.setActive(true);
+    while (m_rendering)
+    {
+        // Between the frame's two ticks, by how far real time is past the
+        // newer one; a frame is never extrapolated beyond its own tick
+        m_renderBuffer.acquire();
+        const RenderFrame& frame = m_renderBuffer.front();
+        float interpolation = static_cast<float>((RenderFrame::now() - frame.due) / frame.tickSeconds);
+        sRender(frame, std::min(std::max(interpolation, 0.0f), 1.0f));
+    }
+    m_window.setActive(false);
+}
+
+void Game::sRender(const RenderFrame & frame, float interpolation)
+{
+    PROFILE_SCOPE("sRender");
+
+    // The score, the timings overlay if on, then every entity in one batch
     m_window.clear();
 
     // Display the score
     m_text.setFont(m_font); // Ensure the font is set
-    m_text.setString("Score: " + std::to_string(m_score));
+    m_text.setString("Score: " + std::to_string(frame.score));
     m_text.setPosition(10, 10);
     m_window.draw(m_text);
 
-    // set the position of the shape based on the entity's transform->pos
-    m_player->cShape->circle.setPosition(m_player->cTransform->pos.x, m_player->cTransform->pos.y);
-
-    // set the rotation of the shape based on the entity's transform->angle
-    m_player->cTransform->angle += 1.0f;
-    m_player->cShape->circle.setRotation(m_player->cTransform->angle);
-    
-    m_window.draw(m_player->cShape->circle);
+    if (frame.showProfile)
+    {
+        m_profileText.setString(frame.profile);
+        m_profileText.setPosition(10, 40);
+        m_window.draw(m_profileText);
+    }
 
-    // set the bullet rendering component
-    for (auto& e : m_entities.getEntities("bullet"))
+    // Laying out each shape's vertex range up front lets the tessellation
+    // itself run in parallel chunks
+    m_drawOffsets.resize(frame.size());
+    size_t vertices = 0;
+    for (size_t i = 0; i < frame.size(); i++)
     {
-        if (e->isActive())
-        {
-            e->cShape->circle.setPosition(e->cTransform->pos.x, e->cTransform->pos.y);
-            m_window.draw(e->cShape->circle);
-        }
+        m_drawOffsets[i] = vertices;
+        vertices += m_batch.vertexCount(frame.points[i], frame.thickness[i]);
     }
 
-    for (auto& e : m_entities.getEntities("enemy"))
+    m_batch.clear();
+    m_batch.resize(vertices);
+    m_renderPool.parallelFor(frame.size(), RENDER_GRAIN, [&](size_t, size_t begin, size_t end)
     {
-        if (e->isActive())
+        PROFILE_SCOPE("sRender chunk");
+        for (size_t i = begin; i < end; i++)
         {
-            e->cShape->circle.setPosition(e->cTransform->pos.x, e->cTransform->pos.y);
-            e->cShape->circle.setRotation(e->cTransform->angle);
-            m_window.draw(e->cShape->circle);
+            float x = frame.prevX[i] + (frame.x[i] - frame.prevX[i]) * interpolation;
+            float y = frame.prevY[i] + (frame.y[i] - frame.prevY[i]) * interpolation;
+            float angle = frame.prevAngle[i] + (frame.angle[i] - frame.prevAngle[i]) * interpolation;
+            m_batch.write(m_drawOffsets[i], frame.points[i], frame.radius[i], frame.thickness[i],
+                          frame.fill[i], frame.outline[i], x, y, angle);
         }
-    }
+    });
+
+    m_window.draw(m_batch.vertices());
 
     m_window.display();
 }
 
 void Game::sUserInput()
 {
+    PROFILE_SCOPE("sUserInput");
+
+    // Held keys go straight to the player's CInput; everything else is queued
+    // in m_tickInput for the next tick
     sf::Event event;
     while (m_window.pollEvent(event))
     {
+        // Looked up per event: F5 and F9 below can move or rebuild the rows
+        CInput& input = m_entities.components().input[m_entities.row(m_player)];
+
         // this event triggers when the window is closed
         if (event.type == sf::Event::Closed)
         {
@@ -543,16 +1122,16 @@ void Game::sUserInput()
             switch (event.key.code)
             {
             case sf::Keyboard::W:
-                m_player->cInput->up = true;
+                input.up = true;
                 break;
             case sf::Keyboard::S:
-                m_player->cInput->down = true;
+                input.down = true;
                 break;
             case sf::Keyboard::A:
-                m_player->cInput->left = true;
+                input.left = true;
                 break;
             case sf::Keyboard::D:
-                m_player->cInput->right = true;
+                input.right = true;
                 break;
             default:
                 break;
@@ -564,33 +1143,62 @@ void Game::sUserInput()
             switch (event.key.code)
             {
             case sf::Keyboard::W:
-                m_player->cInput->up = false;
+                input.up = false;
                 break;
             case sf::Keyboard::S:
-                m_player->cInput->down = false;
+                input.down = false;
                 break;
             case sf::Keyboard::A:
-                m_player->cInput->left = false;
+                input.left = false;
                 break;
             case sf::Keyboard::D:
-                m_player->cInput->right = false;
+                input.right = false;
                 break;
             case sf::Keyboard::P:
                 setPaused();
+                m_tickInput.pauseToggled = true;
+                break;
+            case sf::Keyboard::F5:
+                if (saveSnapshot("snapshot.bin"))
+                {
+                    std::cout << "wrote snapshot.bin\n";
+                }
+                break;
+            case sf::Keyboard::F9:
+                loadSnapshot("snapshot.bin");
+                break;
+            case sf::Keyboard::F3:
+                printMemory(std::cout);
+                break;
+#if PROFILER_ENABLED
+            case sf::Keyboard::F1:
+                m_showProfile = !m_showProfile;
+                break;
+            case sf::Keyboard::F2:
+                if (Profiler::writeTrace("trace.json"))
+                {
+                    std::cout << "wrote trace.json\n";
+                }
+                break;
+#endif
             default:
                 break;
             }
         }
         if (event.type == sf::Event::MouseButtonPressed)
         {
+            // Queued for the next tick, so a recorded run can replay them
+            // at exactly the same point in the simulation
+            int16_t x = static_cast<int16_t>(event.mouseButton.x);
+            int16_t y = static_cast<int16_t>(event.mouseButton.y);
             if (event.mouseButton.button == sf::Mouse::Left)
             {
-                spawnBullet(m_player, Vec2(event.mouseButton.x, event.mouseButton.y));
+                m_tickInput.clicks.push_back({ TickInput::Fire, x, y });
             }
 
             if (event.mouseButton.button == sf::Mouse::Right)
             {
-                spawnSpecialWeapon(m_player);
+                m_tickInput.clicks.push_back({ TickInput::Special, x, y });
             }
         }
     }
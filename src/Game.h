@@ -2,50 +2,162 @@
 
 #include "Entity.h"
 #include "EntityManager.h"
+#include "CommandBuffer.h"
+#include "Prefab.h"
+#include "SpatialHash.h"
+#include "BatchRenderer.h"
+#include "RenderFrame.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+#include "Memory.h"
+#include "InputLog.h"
+#include "Random.h"
+#include "WorldStream.h"
 
 #include <SFML/Graphics.hpp>
+#include <atomic>
+#include <iosfwd>
+#include <thread>
 
 struct PlayerConfig { int SR, CR, FR, FG, FB, OR, OG, OB, OT, V; float S; };
 struct EnemyConfig  { int SR, CR, OR, OG, OB, OT, VMIN, VMAX, L, SI; float SMIN, SMAX; };
 struct BulletConfig { int SR, CR, FR, FG, FB, OR, OG, OB, OT, V, L; float S; };
 
+// A bullet meeting an enemy during a tick, found by sCollision
+struct Contact
+{
+    float       time;       // fraction of the tick, see Collision::sweptCircles
+    uint32_t    enemy;      // the enemy's position in its tag list
+    uint32_t    bullet;     // the bullet's position in its tag list
+};
+
+// A game's running totals, e.g. for a batch run to collect
+struct GameSummary
+{
+    int     score = 0;
+    int     ticks = 0;          // simulation ticks run
+    size_t  entities = 0;
+    size_t  enemies = 0;
+    size_t  bullets = 0;
+};
+
+// Per-enemy spawn parameters for one wave, one array per field
+struct WaveParams
+{
+    std::vector<float> x, y, vx, vy;
+    std::vector<int> points;
+
+    void resize(size_t n) { x.resize(n); y.resize(n); vx.resize(n); vy.resize(n); points.resize(n); }
+};
+
 class Game
 {
-    sf::RenderWindow m_window;     // the window we will draw to
+    friend struct GameBench;       // tests/EcsBenchmark.cpp drives the systems directly
+
+    sf::RenderWindow m_window;     // the window we will draw to (never opened when headless)
+    Vec2 m_worldSize;              // the size of the play field, read from the Window config
     EntityManager m_entities;      // vector of entities to maintain
+    CommandBuffer m_commands;      // spawns and destroys systems defer to the next applyCommands()
     sf::Font m_font;               // the font we will use to draw
     sf::Text m_text;               // the score text to be drawn to the screen
+    sf::Text m_profileText;        // per-system timings, drawn under the score
+    std::vector<Profiler::ScopeStats> m_profileStats;
+    bool m_showProfile = false;    // F1 toggles the timings overlay, F2 writes trace.json
+    WorldMemory m_worldMemory;     // F3 prints it, with the heap figures
+    BatchRenderer m_batch;         // every entity shape, drawn in a single call
+    RenderBuffer m_renderBuffer;   // frames from the simulation to the render thread
+    std::thread m_renderThread;    // draws while run() simulates
+    std::atomic<bool> m_rendering{false};
     PlayerConfig m_playerConfig;
     EnemyConfig m_enemyConfig;
     BulletConfig m_bulletConfig;
+    Prefab m_playerPrefab;         // every spawn is cloned from one of these, built from the configs
+    Prefab m_bulletPrefab;
+    std::vector<Prefab> m_enemyPrefabs;      // by point count - VMIN
+    std::vector<Prefab> m_smallEnemyPrefabs; // the same, a quarter of the size and with a lifespan
     int m_score = 0;               // the score of the player
-    int m_currentFrame = 0;        // the current frame of the game
+    int m_currentFrame = 0;        // the current simulation tick of the game
+    float m_tickRate = 60.0f;      // simulation ticks per second, from the Simulation config
+    int m_maxTicksPerFrame = 5;    // catch-up limit per pass of run()
     int m_lastEnemySpawnTime = 0;  // the last time an enemy was spawned
+    unsigned int m_seed = 0;       // what m_rng was last seeded with
+    Random m_rng;                  // every random draw the simulation makes
+    std::vector<uint32_t> m_waveBits; // raw random numbers for the wave being spawned
+    WaveParams m_wave;
+    TickInput m_tickInput;         // input gathered for the next tick
+    InputRecorder m_recorder;      // logs every tick's input while open
+    InputReplay m_replay;          // supplies every tick's input while open
     bool m_paused = false;
     bool m_running = true;
+    bool m_headless = false;       // simulate without a window, font or rendering
+    SpatialHash m_bulletGrid;      // broadphase for bullet collisions, rebuilt every frame
+    EntityVec m_expired;           // entities whose lifespan ran out this tick
+    std::vector<Contact> m_contacts;   // every bullet-enemy contact this tick, resolved earliest first
+    std::vector<uint8_t> m_bulletHit;  // per bullet-list entry: already spent on an enemy this tick
+    std::vector<uint8_t> m_enemyHit;   // per enemy-list entry: already destroyed by a bullet this tick
+    std::vector<uint32_t> m_drawRows;  // rows to publish, in draw order (simulation thread)
+    WorldStream m_stream;          // world state for a spectator process, if opened
+    std::vector<size_t> m_drawOffsets; // first vertex of each drawn shape in m_batch (render thread)
+    size_t m_threads = 0;          // from the Threads config, 0 for one per core
+    ThreadPool m_pool{1};          // runs the per-entity systems in chunks, started once configured
+    ThreadPool m_renderPool{1};    // tessellates on the render thread; started by run()
 
-    std::shared_ptr<Entity> m_player;
+    Entity m_player;
+    TagId m_playerTag;             // interned once so systems never look tags up by string
+    TagId m_enemyTag;
+    TagId m_bulletTag;
 
-    void readConfig(std::string & head, std::ifstream & fin);
-    void init(const std::string & config);
+    void readConfig(std::string & head, std::istream & fin);
+    void init(std::istream & config);
+    void buildPrefabs();             // after the configs change
     void setPaused();
+    void simulate();                 // advance the simulation by one fixed tick
+    void applyInput();               // hand the tick its input: live or replayed, recorded if asked
+    void applyCommands();            // sync point: play back m_commands
+    void report(int frames, float seconds);
+    void printProfile(std::ostream & out);
+    void printMemory(std::ostream & out);
+    void publishRender(double due);  // copy what to draw into m_renderBuffer
+    void publishStream();            // copy what a spectator sees into m_stream, if it has room
+    void renderLoop();               // the render thread: draw the newest frame, repeatedly
 
-    void checkAndReverseVelocity(std::shared_ptr<Entity> entity);
-    
     void sMovement();                // System: Entity position / movement update
     void sUserInput();               // System: User Input
     void sLifespan();                // System: Lifespan
-    void sRender();                  // System: Render / Drawing
+    void sRender(const RenderFrame & frame, float interpolation); // System: Render / Drawing, blending the frame's two ticks
     void sEnemySpawner();            // System: Spawns Enemies
     void sCollision();               // System: Collisions
 
     void spawnPlayer();
     void spawnEnemy();
-    void spawnSmallEnemies(std::shared_ptr<Entity> entity);
-    void spawnBullet(std::shared_ptr<Entity> entity, const Vec2 & mousePos);
-    void spawnSpecialWeapon(std::shared_ptr<Entity> entity);
+    void spawnEnemyWave(size_t n);
+    void spawnSmallEnemies(Entity entity);
+    void spawnBullet(Entity entity, const Vec2 & mousePos);
+    void spawnSpecialWeapon(Entity entity);
 
 public:
-    Game(const std::string & config);
+    Game(const std::string & config, bool headless = false);
+
+    // A windowless game configured from config.txt-format text, e.g. one of
+    // many in a batch. threads sizes its pool whatever the text says; 1 runs
+    // every system on the calling thread.
+    Game(std::istream & config, size_t threads);
+
     void run();
+    void runHeadless(int frames);  // step the simulation uncapped and print a report
+    void step();                   // one simulation tick, touching no process-wide profiling state
+    GameSummary summary() const;
+
+    void setSeed(unsigned int seed);
+    bool record(const std::string & path);      // log input from now on, for replay()
+
+    // Take every tick's input from a log from now on. The world must be the
+    // one it was recorded from: fresh, or loaded from the same snapshot.
+    bool replay(const std::string & path);
+    void runReplay();                           // run the open log headless to its end, then report like runHeadless
+    bool stream(const std::string & path);      // serve every tick to a spectator on a Unix socket
+
+    // Versioned binary snapshot of the whole world (Snapshot.cpp); false on failure
+    bool saveSnapshot(const std::string & path);
+    bool loadSnapshot(const std::string & path);
 };
@@ -0,0 +1,200 @@
+#include "InputLog.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace
+{
+    const char INPUT_MAGIC[4] = { 'I', 'N', 'P', 'T' };
+    const uint8_t INPUT_VERSION = 2;
+
+    // Record flag bits above the four key bits
+    const uint8_t PAUSE_BIT = 1 << 4;
+    const uint8_t CLICKS_BIT = 1 << 5;
+
+    const size_t HEADER_BYTES = sizeof(INPUT_MAGIC) + 1 + 4 + 4 + 8 + 8;
+
+    void put16(std::ofstream & out, uint16_t v)
+    {
+        char b[2] = { static_cast<char>(v & 0xFF), static_cast<char>(v >> 8) };
+        out.write(b, 2);
+    }
+
+    void put32(std::ofstream & out, uint32_t v)
+    {
+        put16(out, static_cast<uint16_t>(v & 0xFFFF));
+        put16(out, static_cast<uint16_t>(v >> 16));
+    }
+
+    void put64(std::ofstream & out, uint64_t v)
+    {
+        put32(out, static_cast<uint32_t>(v & 0xFFFFFFFFu));
+        put32(out, static_cast<uint32_t>(v >> 32));
+    }
+
+    uint16_t get16(const uint8_t* p)
+    {
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+    }
+
+    uint32_t get32(const uint8_t* p)
+    {
+        return get16(p) | (static_cast<uint32_t>(get16(p + 2)) << 16);
+    }
+
+    uint64_t get64(const uint8_t* p)
+    {
+        return get32(p) | (static_cast<uint64_t>(get32(p + 4)) << 32);
+    }
+}
+
+void TickInput::clear()
+{
+    pauseToggled = false;
+    clicks.clear();
+}
+
+bool InputRecorder::open(const std::string & path, const InputLogStart & start)
+{
+    m_out.open(path, std::ios::binary);
+    if (!m_out)
+    {
+        return false;
+    }
+    m_out.write(INPUT_MAGIC, sizeof INPUT_MAGIC);
+    m_out.put(static_cast<char>(INPUT_VERSION));
+    put32(m_out, start.seed);
+    put32(m_out, start.tick);
+    put64(m_out, start.rngState);
+    put64(m_out, start.rngIncrement);
+    return static_cast<bool>(m_out);
+}
+
+bool InputRecorder::isOpen() const
+{
+    return m_out.is_open();
+}
+
+void InputRecorder::write(const TickInput & input)
+{
+    // At most 255 clicks per tick are kept; nobody clicks that fast
+    size_t clicks = input.clicks.size() < 255 ? input.clicks.size() : 255;
+
+    uint8_t flags = input.keys & 0x0F;
+    flags |= input.pauseToggled ? PAUSE_BIT : 0;
+    flags |= clicks ? CLICKS_BIT : 0;
+    m_out.put(static_cast<char>(flags));
+
+    if (clicks)
+    {
+        m_out.put(static_cast<char>(clicks));
+        for (size_t i = 0; i < clicks; i++)
+        {
+            const TickInput::Click& c = input.clicks[i];
+            m_out.put(static_cast<char>(c.button));
+            put16(m_out, static_cast<uint16_t>(c.x));
+            put16(m_out, static_cast<uint16_t>(c.y));
+        }
+    }
+}
+
+void InputRecorder::close()
+{
+    m_out.close();
+}
+
+bool InputReplay::open(const std::string & path)
+{
+    std::ifstream fin(path, std::ios::binary);
+    if (!fin)
+    {
+        return false;
+    }
+    m_data.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+
+    if (m_data.size() < HEADER_BYTES
+        || !std::equal(INPUT_MAGIC, INPUT_MAGIC + sizeof INPUT_MAGIC, m_data.begin())
+        || m_data[4] != INPUT_VERSION)
+    {
+        m_data.clear();
+        return false;
+    }
+    m_start.seed = get32(&m_data[5]);
+    m_start.tick = get32(&m_data[9]);
+    m_start.rngState = get64(&m_data[13]);
+    m_start.rngIncrement = get64(&m_data[21]);
+    m_offset = HEADER_BYTES;
+
+    // Count the records up front, which also checks the log is not truncated
+    TickInput scratch;
+    m_ticks = 0;
+    while (next(scratch))
+    {
+        m_ticks++;
+    }
+    bool complete = m_offset == m_data.size();
+    m_offset = HEADER_BYTES;
+    if (!complete)
+    {
+        m_data.clear();
+    }
+    return complete;
+}
+
+bool InputReplay::isOpen() const
+{
+    return !m_data.empty();
+}
+
+void InputReplay::close()
+{
+    m_data.clear();
+}
+
+const InputLogStart & InputReplay::start() const
+{
+    return m_start;
+}
+
+size_t InputReplay::ticks() const
+{
+    return m_ticks;
+}
+
+bool InputReplay::next(TickInput & input)
+{
+    if (m_offset >= m_data.size())
+    {
+        return false;
+    }
+
+    size_t at = m_offset;
+    uint8_t flags = m_data[at++];
+    input.keys = flags & 0x0F;
+    input.pauseToggled = (flags & PAUSE_BIT) != 0;
+    input.clicks.clear();
+
+    if (flags & CLICKS_BIT)
+    {
+        if (at >= m_data.size())
+        {
+            return false;
+        }
+        size_t clicks = m_data[at++];
+        if (m_data.size() - at < clicks * 5)
+        {
+            return false;
+        }
+        for (size_t i = 0; i < clicks; i++, at += 5)
+        {
+            TickInput::Click c;
+            c.button = static_cast<TickInput::Button>(m_data[at]);
+            c.x = static_cast<int16_t>(get16(&m_data[at + 1]));
+            c.y = static_cast<int16_t>(get16(&m_data[at + 3]));
+            input.clicks.push_back(c);
+        }
+    }
+
+    m_offset = at;
+    return true;
+}
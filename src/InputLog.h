@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Everything the player did that one simulation tick consumes: the movement
+// keys held, whether P was pressed, and the mouse clicks since the last tick
+struct TickInput
+{
+    enum Keys : uint8_t { Up = 1 << 0, Down = 1 << 1, Left = 1 << 2, Right = 1 << 3 };
+    enum Button : uint8_t { Fire = 0, Special = 1 };   // left / right mouse button
+
+    struct Click
+    {
+        Button  button;
+        int16_t x;
+        int16_t y;
+    };
+
+    uint8_t             keys = 0;
+    bool                pauseToggled = false;
+    std::vector<Click>  clicks;
+
+    void clear();
+};
+
+// Where a log starts: the world's tick and random state when recording began
+struct InputLogStart
+{
+    uint32_t seed = 0;
+    uint32_t tick = 0;
+    uint64_t rngState = 0;
+    uint64_t rngIncrement = 0;
+};
+
+// Input logs: a header with the InputLogStart, then one record per simulation
+// tick. A tick without clicks takes one byte (key bits, pause and click
+// flags); each click adds five. Values are little-endian on every platform.
+//
+// A game started from the same world (fresh with the same config, or loaded
+// from the same snapshot) and fed the same records runs bit-identically,
+// with or without a window.
+class InputRecorder
+{
+    std::ofstream m_out;
+
+public:
+    bool open(const std::string & path, const InputLogStart & start);
+    bool isOpen() const;
+    void write(const TickInput & input);
+    void close();
+};
+
+class InputReplay
+{
+    std::vector<uint8_t>    m_data;
+    size_t                  m_offset = 0;
+    InputLogStart           m_start;
+    size_t                  m_ticks = 0;
+
+public:
+    bool open(const std::string & path);
+    bool isOpen() const;
+    void close();
+    const InputLogStart & start() const;
+    size_t ticks() const;                   // records in the log
+    bool next(TickInput & input);           // false once the log is exhausted
+};
@@ -0,0 +1,244 @@
+#include "Kernels.h"
+
+// x86-64 only: SSE2 is part of its baseline, so moveSSE2 needs no target attribute
+#if defined(__x86_64__) || defined(_M_X64)
+    #define KERNELS_X86
+    #include <immintrin.h>
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+        #define KERNELS_AVX2_TARGET
+    #else
+        #define KERNELS_AVX2_TARGET __attribute__((target("avx2")))
+    #endif
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+    #define KERNELS_NEON
+    #include <arm_neon.h>
+#endif
+
+namespace
+{
+    // Scalar versions: the reference every SIMD version must match exactly
+
+    void moveScalar(ComponentStore & c, size_t begin, size_t end, float width, float height)
+    {
+        float* posX = c.posX.data();
+        float* posY = c.posY.data();
+        float* velX = c.velX.data();
+        float* velY = c.velY.data();
+        float* angle = c.angle.data();
+        const float* spin = c.spin.data();
+        const uint32_t* bounce = c.bounce.data();
+
+        for (size_t i = begin; i < end; i++)
+        {
+            posX[i] -= velX[i];
+            posY[i] -= velY[i];
+
+            bool hitX = posX[i] <= 0 || posX[i] >= width;
+            bool hitY = posY[i] <= 0 || posY[i] >= height;
+            velX[i] = (bounce[i] && hitX) ? -velX[i] : velX[i];
+            velY[i] = (bounce[i] && hitY) ? -velY[i] : velY[i];
+
+            angle[i] += spin[i];
+        }
+    }
+
+#if defined(KERNELS_X86)
+    void moveSSE2(ComponentStore & c, size_t begin, size_t end, float width, float height)
+    {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 w = _mm_set1_ps(width);
+        const __m128 h = _mm_set1_ps(height);
+        const __m128 sign = _mm_set1_ps(-0.0f);
+
+        size_t i = begin;
+        for (; i + 4 <= end; i += 4)
+        {
+            __m128 vx = _mm_loadu_ps(&c.velX[i]);
+            __m128 vy = _mm_loadu_ps(&c.velY[i]);
+            __m128 px = _mm_sub_ps(_mm_loadu_ps(&c.posX[i]), vx);
+            __m128 py = _mm_sub_ps(_mm_loadu_ps(&c.posY[i]), vy);
+            __m128 bounce = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&c.bounce[i])));
+
+            __m128 hitX = _mm_or_ps(_mm_cmple_ps(px, zero), _mm_cmpge_ps(px, w));
+            __m128 hitY = _mm_or_ps(_mm_cmple_ps(py, zero), _mm_cmpge_ps(py, h));
+            vx = _mm_xor_ps(vx, _mm_and_ps(_mm_and_ps(hitX, bounce), sign));
+            vy = _mm_xor_ps(vy, _mm_and_ps(_mm_and_ps(hitY, bounce), sign));
+
+            _mm_storeu_ps(&c.posX[i], px);
+            _mm_storeu_ps(&c.posY[i], py);
+            _mm_storeu_ps(&c.velX[i], vx);
+            _mm_storeu_ps(&c.velY[i], vy);
+            _mm_storeu_ps(&c.angle[i], _mm_add_ps(_mm_loadu_ps(&c.angle[i]), _mm_loadu_ps(&c.spin[i])));
+        }
+        moveScalar(c, i, end, width, height);
+    }
+
+    KERNELS_AVX2_TARGET
+    void moveAVX2(ComponentStore & c, size_t begin, size_t end, float width, float height)
+    {
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 w = _mm256_set1_ps(width);
+        const __m256 h = _mm256_set1_ps(height);
+        const __m256 sign = _mm256_set1_ps(-0.0f);
+
+        size_t i = begin;
+        for (; i + 8 <= end; i += 8)
+        {
+            __m256 vx = _mm256_loadu_ps(&c.velX[i]);
+            __m256 vy = _mm256_loadu_ps(&c.velY[i]);
+            __m256 px = _mm256_sub_ps(_mm256_loadu_ps(&c.posX[i]), vx);
+            __m256 py = _mm256_sub_ps(_mm256_loadu_ps(&c.posY[i]), vy);
+            __m256 bounce = _mm256_castsi256_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&c.bounce[i])));
+
+            __m256 hitX = _mm256_or_ps(_mm256_cmp_ps(px, zero, _CMP_LE_OQ), _mm256_cmp_ps(px, w, _CMP_GE_OQ));
+            __m256 hitY = _mm256_or_ps(_mm256_cmp_ps(py, zero, _CMP_LE_OQ), _mm256_cmp_ps(py, h, _CMP_GE_OQ));
+            vx = _mm256_xor_ps(vx, _mm256_and_ps(_mm256_and_ps(hitX, bounce), sign));
+            vy = _mm256_xor_ps(vy, _mm256_and_ps(_mm256_and_ps(hitY, bounce), sign));
+
+            _mm256_storeu_ps(&c.posX[i], px);
+            _mm256_storeu_ps(&c.posY[i], py);
+            _mm256_storeu_ps(&c.velX[i], vx);
+            _mm256_storeu_ps(&c.velY[i], vy);
+            _mm256_storeu_ps(&c.angle[i], _mm256_add_ps(_mm256_loadu_ps(&c.angle[i]), _mm256_loadu_ps(&c.spin[i])));
+        }
+        moveSSE2(c, i, end, width, height);
+    }
+
+    bool cpuHasAVX2()
+    {
+    #if defined(_MSC_VER) && !defined(__clang__)
+        // AVX2 needs the CPU flag and the OS saving the YMM registers
+        int info[4];
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+        {
+            return false;
+        }
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+    #else
+        return __builtin_cpu_supports("avx2");
+    #endif
+    }
+#endif
+
+#if defined(KERNELS_NEON)
+    void moveNEON(ComponentStore & c, size_t begin, size_t end, float width, float height)
+    {
+        const float32x4_t zero = vdupq_n_f32(0.0f);
+        const float32x4_t w = vdupq_n_f32(width);
+        const float32x4_t h = vdupq_n_f32(height);
+        const uint32x4_t sign = vdupq_n_u32(0x80000000u);
+
+        size_t i = begin;
+        for (; i + 4 <= end; i += 4)
+        {
+            float32x4_t vx = vld1q_f32(&c.velX[i]);
+            float32x4_t vy = vld1q_f32(&c.velY[i]);
+            float32x4_t px = vsubq_f32(vld1q_f32(&c.posX[i]), vx);
+            float32x4_t py = vsubq_f32(vld1q_f32(&c.posY[i]), vy);
+            uint32x4_t bounce = vld1q_u32(&c.bounce[i]);
+
+            uint32x4_t hitX = vorrq_u32(vcleq_f32(px, zero), vcgeq_f32(px, w));
+            uint32x4_t hitY = vorrq_u32(vcleq_f32(py, zero), vcgeq_f32(py, h));
+            uint32x4_t flipX = vandq_u32(vandq_u32(hitX, bounce), sign);
+            uint32x4_t flipY = vandq_u32(vandq_u32(hitY, bounce), sign);
+            vx = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(vx), flipX));
+            vy = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(vy), flipY));
+
+            vst1q_f32(&c.posX[i], px);
+            vst1q_f32(&c.posY[i], py);
+            vst1q_f32(&c.velX[i], vx);
+            vst1q_f32(&c.velY[i], vy);
+            vst1q_f32(&c.angle[i], vaddq_f32(vld1q_f32(&c.angle[i]), vld1q_f32(&c.spin[i])));
+        }
+        moveScalar(c, i, end, width, height);
+    }
+
+#endif
+
+    struct Table
+    {
+        Kernels::Isa isa;
+        void (*move)(ComponentStore &, size_t, size_t, float, float);
+    };
+
+    Table tableFor(Kernels::Isa isa)
+    {
+        switch (isa)
+        {
+    #if defined(KERNELS_X86)
+        case Kernels::Isa::SSE2:
+            return { isa, moveSSE2 };
+        case Kernels::Isa::AVX2:
+            return { isa, moveAVX2 };
+    #endif
+    #if defined(KERNELS_NEON)
+        case Kernels::Isa::NEON:
+            return { isa, moveNEON };
+    #endif
+        default:
+            return { Kernels::Isa::Scalar, moveScalar };
+        }
+    }
+
+    Table & table()
+    {
+        static Table t = tableFor(Kernels::best());
+        return t;
+    }
+}
+
+namespace Kernels
+{
+    Isa best()
+    {
+    #if defined(KERNELS_X86)
+        // SSE2 is part of the x86-64 baseline
+        return cpuHasAVX2() ? Isa::AVX2 : Isa::SSE2;
+    #elif defined(KERNELS_NEON)
+        return Isa::NEON;
+    #else
+        return Isa::Scalar;
+    #endif
+    }
+
+    Isa active()
+    {
+        return table().isa;
+    }
+
+    bool use(Isa isa)
+    {
+        bool supported = isa == Isa::Scalar;
+    #if defined(KERNELS_X86)
+        supported = supported || isa == Isa::SSE2 || (isa == Isa::AVX2 && cpuHasAVX2());
+    #elif defined(KERNELS_NEON)
+        supported = supported || isa == Isa::NEON;
+    #endif
+        if (supported)
+        {
+            table() = tableFor(isa);
+        }
+        return supported;
+    }
+
+    const char* name(Isa isa)
+    {
+        switch (isa)
+        {
+        case Isa::SSE2: return "sse2";
+        case Isa::AVX2: return "avx2";
+        case Isa::NEON: return "neon";
+        default:        return "scalar";
+        }
+    }
+
+    void move(ComponentStore & c, size_t begin, size_t end, float width, float height)
+    {
+        table().move(c, begin, end, width, height);
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "ComponentStore.h"
+#include <vector>
+#include <cstdint>
+
+// Data-parallel kernels for the per-entity systems, working directly on the
+// ComponentStore arrays. Each kernel has a scalar version plus SSE2 / AVX2
+// (x86) or NEON (ARM) versions processing 4 or 8 rows per instruction. The
+// best one the CPU supports is picked at runtime; use() can force another,
+// e.g. to compare them in the benchmark. Every version gives bit-identical
+// results to the scalar one.
+namespace Kernels
+{
+    enum class Isa { Scalar, SSE2, AVX2, NEON };
+
+    Isa best();                 // the widest instruction set this CPU supports
+    Isa active();               // the instruction set the kernels currently use
+    bool use(Isa isa);          // false (and no change) if the CPU lacks it
+    const char* name(Isa isa);
+
+    // Rows [begin, end): pos -= velocity, then rows with CBounce reverse the
+    // velocity on each axis where they are at or past the world edge, then
+    // angle += spin. Branch-free: the bounce is a sign flip under a lane mask.
+    void move(ComponentStore & c, size_t begin, size_t end, float width, float height);
+}
@@ -0,0 +1,240 @@
+#include "Memory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    // Frames of history behind frameStats()
+    const size_t HISTORY = 128;
+
+    // Threads that get a counter block of their own; any more share the last
+    const size_t THREAD_SLOTS = 64;
+
+    // One thread's counts. Its owner updates them with plain loads and
+    // stores, no read-modify-write; the shared block, written by several
+    // threads, takes fetch_add.
+    struct alignas(64) ThreadCounters
+    {
+        std::atomic<size_t> allocations{0};
+        std::atomic<size_t> frees{0};
+        std::atomic<size_t> bytes{0};
+        std::atomic<size_t> freedBytes{0};
+        std::atomic<bool>   used{false};
+    };
+
+    ThreadCounters      g_threads[THREAD_SLOTS + 1];
+    ThreadCounters&     g_shared = g_threads[THREAD_SLOTS];
+    std::atomic<size_t> g_peakBytes{0};
+
+    struct Frame
+    {
+        size_t allocations;
+        size_t bytes;
+        size_t liveBytes;           // at the end of the frame
+    };
+
+    Frame               g_frames[HISTORY];  // oldest overwritten first
+    size_t              g_frameCount = 0;
+    size_t              g_nextFrame = 0;
+    Memory::Counters    g_lastFrame;        // counters at the last endFrame()
+}
+
+#if MEMORY_TRACKING
+
+namespace
+{
+    void add(std::atomic<size_t> & counter, size_t value, bool owned)
+    {
+        if (owned)
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        } else
+        {
+            counter.fetch_add(value, std::memory_order_relaxed);
+        }
+    }
+
+    // The calling thread's block, claimed on its first allocation. When the
+    // thread exits its counts move to the shared block and the slot is freed
+    // for the next thread, so pools that come and go do not run out of slots.
+    struct ThreadSlot
+    {
+        ThreadCounters* counters = nullptr;
+        bool            owned = false;
+
+        ThreadCounters & get()
+        {
+            if (!counters)
+            {
+                counters = &g_shared;
+                for (size_t i = 0; i < THREAD_SLOTS; i++)
+                {
+                    bool unused = false;
+                    if (g_threads[i].used.compare_exchange_strong(unused, true, std::memory_order_acquire))
+                    {
+                        counters = &g_threads[i];
+                        owned = true;
+                        break;
+                    }
+                }
+            }
+            return *counters;
+        }
+
+        ~ThreadSlot()
+        {
+            if (owned)
+            {
+                ThreadCounters& c = *counters;
+                size_t allocations = c.allocations.exchange(0, std::memory_order_relaxed);
+                size_t frees = c.frees.exchange(0, std::memory_order_relaxed);
+                size_t bytes = c.bytes.exchange(0, std::memory_order_relaxed);
+                size_t freedBytes = c.freedBytes.exchange(0, std::memory_order_relaxed);
+                add(g_shared.allocations, allocations, false);
+                add(g_shared.frees, frees, false);
+                add(g_shared.bytes, bytes, false);
+                add(g_shared.freedBytes, freedBytes, false);
+                c.used.store(false, std::memory_order_release);
+            }
+
+            // Frees from destructors that run after this one count there too
+            counters = &g_shared;
+            owned = false;
+        }
+    };
+
+    // Each block starts with its requested size so delete knows what it
+    // frees. A whole max_align_t keeps the caller's pointer as aligned as
+    // malloc()'s own.
+    const size_t HEADER = alignof(std::max_align_t);
+
+    thread_local ThreadSlot t_slot;
+
+    void* allocate(size_t size) noexcept
+    {
+        void* block = std::malloc(HEADER + size);
+        if (!block)
+        {
+            return nullptr;
+        }
+        *static_cast<size_t*>(block) = size;
+
+        ThreadCounters& c = t_slot.get();
+        add(c.allocations, 1, t_slot.owned);
+        add(c.bytes, size, t_slot.owned);
+        return static_cast<char*>(block) + HEADER;
+    }
+
+    void release(void* p) noexcept
+    {
+        if (!p)
+        {
+            return;
+        }
+        char* block = static_cast<char*>(p) - HEADER;
+        ThreadCounters& c = t_slot.get();
+        add(c.frees, 1, t_slot.owned);
+        add(c.freedBytes, *reinterpret_cast<size_t*>(block), t_slot.owned);
+        std::free(block);
+    }
+
+    void* allocateOrThrow(size_t size)
+    {
+        void* p = allocate(size);
+        if (!p)
+        {
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+}
+
+// Every replaceable form that can reach malloc() directly, so no block
+// without a header ever gets to release(). The over-aligned forms are left
+// to the library; they allocate and free on their own, uncounted.
+void* operator new(size_t size) { return allocateOrThrow(size); }
+void* operator new[](size_t size) { return allocateOrThrow(size); }
+void* operator new(size_t size, const std::nothrow_t &) noexcept { return allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t &) noexcept { return allocate(size); }
+
+void operator delete(void* p) noexcept { release(p); }
+void operator delete[](void* p) noexcept { release(p); }
+void operator delete(void* p, size_t) noexcept { release(p); }
+void operator delete[](void* p, size_t) noexcept { release(p); }
+void operator delete(void* p, const std::nothrow_t &) noexcept { release(p); }
+void operator delete[](void* p, const std::nothrow_t &) noexcept { release(p); }
+
+#endif
+
+bool Memory::tracking()
+{
+    return MEMORY_TRACKING != 0;
+}
+
+Memory::Counters Memory::counters()
+{
+    // Blocks are summed one after another while their threads carry on, so
+    // a free may be seen without its allocation; live bytes never go below 0
+    Counters c;
+    size_t freedBytes = 0;
+    for (const ThreadCounters& t : g_threads)
+    {
+        c.allocations += t.allocations.load(std::memory_order_relaxed);
+        c.frees += t.frees.load(std::memory_order_relaxed);
+        c.bytes += t.bytes.load(std::memory_order_relaxed);
+        freedBytes += t.freedBytes.load(std::memory_order_relaxed);
+    }
+    c.liveBytes = c.bytes > freedBytes ? c.bytes - freedBytes : 0;
+
+    size_t peak = g_peakBytes.load(std::memory_order_relaxed);
+    while (c.liveBytes > peak && !g_peakBytes.compare_exchange_weak(peak, c.liveBytes, std::memory_order_relaxed))
+    {
+    }
+    c.peakBytes = std::max(peak, c.liveBytes);
+    return c;
+}
+
+void Memory::endFrame()
+{
+    Counters now = counters();
+    Frame& f = g_frames[g_nextFrame];
+    f.allocations = now.allocations - g_lastFrame.allocations;
+    f.bytes = now.bytes - g_lastFrame.bytes;
+    f.liveBytes = now.liveBytes;
+    g_lastFrame = now;
+
+    g_nextFrame = (g_nextFrame + 1) % HISTORY;
+    g_frameCount = std::min(g_frameCount + 1, HISTORY);
+}
+
+Memory::FrameStats Memory::frameStats()
+{
+    FrameStats st;
+    st.frames = g_frameCount;
+    if (g_frameCount == 0)
+    {
+        return st;
+    }
+
+    size_t live[HISTORY];
+    double allocs = 0;
+    double bytes = 0;
+    for (size_t i = 0; i < g_frameCount; i++)
+    {
+        const Frame& f = g_frames[i];
+        allocs += f.allocations;
+        bytes += f.bytes;
+        st.peakAllocsPerFrame = std::max(st.peakAllocsPerFrame, f.allocations);
+        st.peakFrameBytes = std::max(st.peakFrameBytes, f.liveBytes);
+        live[i] = f.liveBytes;
+    }
+    std::nth_element(live, live + g_frameCount / 2, live + g_frameCount);
+
+    st.allocsPerFrame = allocs / g_frameCount;
+    st.bytesPerFrame = bytes / g_frameCount;
+    st.steadyBytes = live[g_frameCount / 2];
+    return st;
+}
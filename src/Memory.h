@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Heap accounting. Memory.cpp replaces the global operator new and delete
+// with versions that count every allocation the process makes, from any
+// thread, and the bytes still live. Each thread counts in its own cache
+// line, so allocating threads never share a counter; counters() sums them.
+// Once per frame Memory::endFrame() folds the counters into a rolling
+// history, from which frameStats() reports allocations per frame and the
+// steady-state and peak heap.
+//
+// Where the bytes go is reported by the structures that own them as Usage
+// entries, e.g. EntityManager::memory() per component type and per tag.
+//
+// Build with -DMEMORY_TRACKING=0 to leave the allocator alone; the counters
+// then stay at zero.
+#ifndef MEMORY_TRACKING
+    #define MEMORY_TRACKING 1
+#endif
+
+namespace Memory
+{
+    struct Counters
+    {
+        size_t allocations = 0;     // operator new calls since startup
+        size_t frees = 0;
+        size_t bytes = 0;           // requested by those allocations in total
+        size_t liveBytes = 0;       // requested and not yet freed
+        size_t peakBytes = 0;       // most live at any counters() call so far (endFrame() makes one)
+    };
+
+    // Over the frames in the rolling window
+    struct FrameStats
+    {
+        size_t frames = 0;
+        double allocsPerFrame = 0;      // average
+        size_t peakAllocsPerFrame = 0;
+        double bytesPerFrame = 0;       // average allocated, not net growth
+        size_t steadyBytes = 0;         // median live bytes at the end of a frame
+        size_t peakFrameBytes = 0;      // most live bytes at the end of a frame
+    };
+
+    // Bytes held by one part of a structure
+    struct Usage
+    {
+        std::string name;
+        size_t      count = 0;          // rows, entities or entries it covers
+        size_t      bytes = 0;          // used by them
+        size_t      reserved = 0;       // allocated for it, used or not
+    };
+
+    template <typename T>
+    Usage usage(const std::string & name, const std::vector<T> & v)
+    {
+        return { name, v.size(), v.size() * sizeof(T), v.capacity() * sizeof(T) };
+    }
+
+    bool tracking();                // false when built with MEMORY_TRACKING=0
+    Counters counters();            // safe from any thread
+
+    // Call once per frame from the main thread, like Profiler::endFrame()
+    void endFrame();
+    FrameStats frameStats();
+}
@@ -0,0 +1,32 @@
+#include "Prefab.h"
+
+Prefab::Prefab()
+    : Prefab(0)
+{
+}
+
+Prefab::Prefab(TagId tag)
+    : m_tag(tag)
+{
+    m_row.push();
+}
+
+TagId Prefab::tag() const
+{
+    return m_tag;
+}
+
+const ComponentStore & Prefab::components() const
+{
+    return m_row;
+}
+
+void Prefab::add(const CLifespan & lifespan)
+{
+    m_row.add(0, lifespan, 0);
+}
+
+CShape & Prefab::addShape()
+{
+    return m_row.addShape(0);
+}
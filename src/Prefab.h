@@ -0,0 +1,35 @@
+#pragma once
+
+#include "EntityManager.h"
+
+// A pre-built entity: a tag and one row of components, put together once
+// (from config, say) with the same add() calls an entity takes. Spawning
+// one with EntityManager::instantiate() copies the whole row into the new
+// entity's row in a single pass, the shape's vertices included, instead of
+// rebuilding each component; an sf::CircleShape recomputes its points on
+// every setter. Per-instance values such as position or colour are then
+// set on the new entity as usual, overwriting the copied ones.
+class Prefab
+{
+    TagId           m_tag = 0;
+    ComponentStore  m_row;      // holds the one row, 0
+
+public:
+    Prefab();
+    explicit Prefab(TagId tag);
+
+    TagId tag() const;
+    const ComponentStore & components() const;
+
+    template <typename C>
+    void add(const C & component)
+    {
+        m_row.add(0, component);
+    }
+
+    // Counted from when each instance is committed, like any lifespan added
+    // to an entity before update()
+    void add(const CLifespan & lifespan);
+
+    CShape & addShape();        // the prefab's shape, to set() in place
+};
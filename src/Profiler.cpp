@@ -0,0 +1,266 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+
+namespace
+{
+    struct Event
+    {
+        const char* name;
+        uint64_t    start;
+        uint64_t    end;
+    };
+
+    // A ring entry. Fields are relaxed atomics so a reader may copy a slot
+    // while its owner overwrites it; readEvent() then discards the copy.
+    struct EventSlot
+    {
+        std::atomic<const char*>    name{nullptr};
+        std::atomic<uint64_t>       start{0};
+        std::atomic<uint64_t>       end{0};
+    };
+
+    // Events per thread kept for traces; a power of two so the ring index is a mask
+    const size_t RING_SIZE = 1 << 14;
+
+    // Frames of history behind the rolling min / avg / p99
+    const size_t HISTORY = 128;
+
+    // One per thread that has recorded anything. Only the owning thread
+    // writes; head is published with release so a reader that acquires it
+    // sees every event before it. Readers run alongside the owner, which may
+    // be overwriting the oldest slot, so they copy events out with readEvent().
+    struct ThreadRing
+    {
+        EventSlot               events[RING_SIZE];
+        std::atomic<uint64_t>   head{0};
+        uint64_t                read = 0;       // endFrame()'s cursor
+        size_t                  tid = 0;
+    };
+
+    struct Series
+    {
+        const char* name = nullptr;
+        float       samples[HISTORY] = {};      // ms per frame, oldest overwritten first
+        size_t      count = 0;
+        size_t      next = 0;
+        double      frameMs = 0;
+        bool        seen = false;
+    };
+
+    std::mutex                                  g_ringsMutex;
+    std::vector<std::unique_ptr<ThreadRing>>    g_rings;
+    std::vector<Series>                         g_series;
+    thread_local ThreadRing*                    t_ring = nullptr;
+
+    ThreadRing & ring()
+    {
+        if (!t_ring)
+        {
+            // Once per thread, so the lock stays off the recording path
+            std::lock_guard<std::mutex> lock(g_ringsMutex);
+            g_rings.emplace_back(new ThreadRing());
+            t_ring = g_rings.back().get();
+            t_ring->tid = g_rings.size() - 1;
+        }
+        return *t_ring;
+    }
+
+    Series & series(const char* name)
+    {
+        // The same literal can have a different address in each translation unit
+        for (auto& s : g_series)
+        {
+            if (s.name == name || std::strcmp(s.name, name) == 0)
+            {
+                return s;
+            }
+        }
+        g_series.emplace_back();
+        g_series.back().name = name;
+        return g_series.back();
+    }
+
+    // Copies event i (an index below head) and returns false if the owner may
+    // have started overwriting it, i.e. head has since reached i + RING_SIZE.
+    // The owner fences before writing a slot, so a copy holding any part of a
+    // newer event is always followed by a head load that sees that event.
+    bool readEvent(const ThreadRing & r, uint64_t i, Event & out)
+    {
+        const EventSlot& slot = r.events[i & (RING_SIZE - 1)];
+        out.name = slot.name.load(std::memory_order_relaxed);
+        out.start = slot.start.load(std::memory_order_relaxed);
+        out.end = slot.end.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return r.head.load(std::memory_order_relaxed) < i + RING_SIZE;
+    }
+
+    // JSON string body; scope names are literals, but quote them properly anyway
+    void writeEscaped(std::ofstream & out, const char* s)
+    {
+        for (; *s; s++)
+        {
+            if (*s == '"' || *s == '\\')
+            {
+                out << '\\';
+            }
+            out << *s;
+        }
+    }
+}
+
+uint64_t Profiler::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::record(const char* name, uint64_t start, uint64_t end)
+{
+    ThreadRing& r = ring();
+    uint64_t h = r.head.load(std::memory_order_relaxed);
+    EventSlot& slot = r.events[h & (RING_SIZE - 1)];
+
+    // Pairs with readEvent()'s acquire fence; free on x86
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start.store(start, std::memory_order_relaxed);
+    slot.end.store(end, std::memory_order_relaxed);
+    r.head.store(h + 1, std::memory_order_release);
+}
+
+void Profiler::endFrame()
+{
+    std::lock_guard<std::mutex> lock(g_ringsMutex);
+    for (auto& r : g_rings)
+    {
+        uint64_t head = r->head.load(std::memory_order_acquire);
+
+        // Events overwritten before we got to them are lost, not misread
+        if (head - r->read > RING_SIZE)
+        {
+            r->read = head - RING_SIZE;
+        }
+
+        Event e;
+        for (; r->read < head; r->read++)
+        {
+            if (!readEvent(*r, r->read, e))
+            {
+                continue;
+            }
+            Series& s = series(e.name);
+            s.frameMs += (e.end - e.start) * 1e-6;
+            s.seen = true;
+        }
+    }
+
+    // A scope that ran several times this frame (per tick, per chunk)
+    // contributes its total; scopes that did not run add no sample
+    for (auto& s : g_series)
+    {
+        if (s.seen)
+        {
+            s.samples[s.next] = static_cast<float>(s.frameMs);
+            s.next = (s.next + 1) % HISTORY;
+            s.count = std::min(s.count + 1, HISTORY);
+        }
+        s.frameMs = 0;
+        s.seen = false;
+    }
+}
+
+void Profiler::stats(std::vector<ScopeStats> & out)
+{
+    out.resize(g_series.size());
+    for (size_t i = 0; i < g_series.size(); i++)
+    {
+        const Series& s = g_series[i];
+        ScopeStats& st = out[i];
+        st = ScopeStats();
+        st.name = s.name;
+        st.frames = s.count;
+        if (s.count == 0)
+        {
+            continue;
+        }
+
+        float sorted[HISTORY];
+        std::copy(s.samples, s.samples + s.count, sorted);
+        std::sort(sorted, sorted + s.count);
+
+        double sum = 0;
+        for (size_t j = 0; j < s.count; j++)
+        {
+            sum += sorted[j];
+        }
+        st.minMs = sorted[0];
+        st.avgMs = sum / s.count;
+        st.p99Ms = sorted[(s.count * 99 + 99) / 100 - 1];
+    }
+}
+
+bool Profiler::writeTrace(const std::string & path)
+{
+    std::ofstream out(path);
+    if (!out)
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(g_ringsMutex);
+
+    // Timestamps are relative to the oldest event so they stay short and exact.
+    // Both passes cover the same events, as of the heads read here; the
+    // second can only find fewer of them, so none starts before origin.
+    std::vector<uint64_t> heads(g_rings.size());
+    uint64_t origin = UINT64_MAX;
+    for (size_t t = 0; t < g_rings.size(); t++)
+    {
+        const ThreadRing* r = g_rings[t].get();
+        uint64_t head = heads[t] = r->head.load(std::memory_order_acquire);
+        uint64_t begin = head > RING_SIZE ? head - RING_SIZE : 0;
+        Event e;
+        for (uint64_t i = begin; i < head; i++)
+        {
+            if (readEvent(*r, i, e))
+            {
+                origin = std::min(origin, e.start);
+            }
+        }
+    }
+
+    // Complete ("X") events, timestamps in microseconds
+    out << std::fixed << std::setprecision(3);
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+    for (size_t t = 0; t < g_rings.size(); t++)
+    {
+        const ThreadRing* r = g_rings[t].get();
+        uint64_t head = heads[t];
+        uint64_t begin = head > RING_SIZE ? head - RING_SIZE : 0;
+        Event e;
+        for (uint64_t i = begin; i < head; i++)
+        {
+            if (!readEvent(*r, i, e))
+            {
+                continue;
+            }
+            out << (first ? "" : ",\n") << "{\"name\":\"";
+            writeEscaped(out, e.name);
+            out << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << r->tid
+                << ",\"ts\":" << (e.start - origin) / 1000.0
+                << ",\"dur\":" << (e.end - e.start) / 1000.0 << "}";
+            first = false;
+        }
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
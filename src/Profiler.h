@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Scoped frame profiler. PROFILE_SCOPE("name") times the rest of the
+// enclosing block and appends the event to a ring buffer owned by the calling
+// thread: a single writer per buffer, so recording never locks. Once per frame
+// Profiler::endFrame() folds the new events into a rolling history per scope
+// name (min / avg / p99 of the per-frame totals), and writeTrace() dumps the
+// events still in the rings as Chrome trace_event JSON (chrome://tracing or
+// ui.perfetto.dev). Both may run while other threads keep recording: an event
+// its thread overwrites while it is being read is dropped, not misread.
+//
+// Build with -DPROFILER_ENABLED=0 to compile every PROFILE_* macro to nothing.
+#ifndef PROFILER_ENABLED
+    #define PROFILER_ENABLED 1
+#endif
+
+namespace Profiler
+{
+    struct ScopeStats
+    {
+        const char* name = nullptr;
+        double      minMs = 0;
+        double      avgMs = 0;
+        double      p99Ms = 0;
+        size_t      frames = 0;     // frames in the rolling window that ran this scope
+    };
+
+    uint64_t now();                 // ns on a steady clock
+    void record(const char* name, uint64_t start, uint64_t end);
+
+    // Call once per frame from the main thread. Other threads may be inside a
+    // scope meanwhile (e.g. the render thread); such a scope counts towards
+    // the frame whose endFrame() first sees it finished.
+    void endFrame();
+
+    void stats(std::vector<ScopeStats> & out);      // one entry per scope name seen
+    bool writeTrace(const std::string & path);
+}
+
+class ProfileScope
+{
+    const char* m_name;
+    uint64_t    m_start;
+
+public:
+    explicit ProfileScope(const char* name)     // name must be a string literal
+        : m_name(name)
+        , m_start(Profiler::now())
+    {}
+
+    ~ProfileScope()
+    {
+        Profiler::record(m_name, m_start, Profiler::now());
+    }
+};
+
+#if PROFILER_ENABLED
+    #define PROFILE_JOIN2(a, b) a##b
+    #define PROFILE_JOIN(a, b) PROFILE_JOIN2(a, b)
+    #define PROFILE_SCOPE(name) ProfileScope PROFILE_JOIN(profileScope, __LINE__)(name)
+    #define PROFILE_END_FRAME() Profiler::endFrame()
+#else
+    #define PROFILE_SCOPE(name)
+    #define PROFILE_END_FRAME()
+#endif
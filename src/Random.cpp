@@ -0,0 +1,100 @@
+#include "Random.h"
+
+Random::Random(uint64_t seed, uint64_t stream)
+{
+    this->seed(seed, stream);
+}
+
+void Random::seed(uint64_t seed, uint64_t stream)
+{
+    // pcg32_srandom_r
+    m_state = 0;
+    m_inc = (stream << 1) | 1;
+    next();
+    m_state += seed;
+    next();
+}
+
+Random Random::stream(uint64_t id) const
+{
+    // Reuse this generator's current state as the seed, on a stream derived
+    // from the id; distinct increments give unrelated sequences
+    Random r;
+    r.seed(m_state, (m_inc >> 1) + id + 1);
+    return r;
+}
+
+uint32_t Random::next()
+{
+    uint64_t old = m_state;
+    m_state = old * 6364136223846793005ULL + m_inc;
+    uint32_t xorshifted = static_cast<uint32_t>(((old >> 18) ^ old) >> 27);
+    uint32_t rot = static_cast<uint32_t>(old >> 59);
+    return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+}
+
+void Random::fill(uint32_t* out, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        out[i] = next();
+    }
+}
+
+uint32_t Random::below(uint32_t bound)
+{
+    // Lemire's multiply-shift, rejecting the few low products that would
+    // make some results more likely than others
+    uint64_t m = static_cast<uint64_t>(next()) * bound;
+    uint32_t low = static_cast<uint32_t>(m);
+    if (low < bound)
+    {
+        uint32_t threshold = (0u - bound) % bound;
+        while (low < threshold)
+        {
+            m = static_cast<uint64_t>(next()) * bound;
+            low = static_cast<uint32_t>(m);
+        }
+    }
+    return static_cast<uint32_t>(m >> 32);
+}
+
+int Random::range(int lo, int hi)
+{
+    if (hi <= lo)
+    {
+        return lo;
+    }
+    return lo + static_cast<int>(below(static_cast<uint32_t>(hi - lo) + 1));
+}
+
+float Random::unit()
+{
+    return unit(next());
+}
+
+float Random::range(float lo, float hi)
+{
+    return lo + (hi - lo) * unit();
+}
+
+bool Random::coin()
+{
+    return (next() >> 31) != 0;
+}
+
+uint64_t Random::state() const
+{
+    return m_state;
+}
+
+uint64_t Random::increment() const
+{
+    return m_inc;
+}
+
+void Random::restore(uint64_t state, uint64_t increment)
+{
+    m_state = state;
+    m_inc = increment | 1;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// PCG32 (pcg32_random_r from pcg-random.org): 64 bits of state, 32-bit
+// outputs, a few cycles per number. Every Game owns one, so there is no
+// hidden global state, and the whole state can be saved and restored.
+// Generators are not shared between threads: give each thread its own
+// stream() instead, which is independent of every other stream.
+class Random
+{
+    uint64_t m_state = 0;
+    uint64_t m_inc = 1;         // stream selector, always odd
+
+public:
+    Random(uint64_t seed = 0, uint64_t stream = 0);
+
+    void seed(uint64_t seed, uint64_t stream = 0);
+    Random stream(uint64_t id) const;       // same seed, a different sequence
+
+    uint32_t next();
+    void fill(uint32_t* out, size_t count); // count raw outputs, for batch use
+
+    uint32_t below(uint32_t bound);         // [0, bound), exactly uniform
+    int range(int lo, int hi);              // [lo, hi], exactly uniform
+    float unit();                           // [0, 1) in steps of 2^-24
+    float range(float lo, float hi);        // [lo, hi)
+    bool coin();
+
+    // The raw state, for snapshots
+    uint64_t state() const;
+    uint64_t increment() const;
+    void restore(uint64_t state, uint64_t increment);
+
+    // Branch-free conversions of a raw output, for filling whole arrays in one
+    // vectorisable pass. below() is biased by under bound / 2^32, which is
+    // invisible for the small ranges the spawners use.
+    static uint32_t below(uint32_t bits, uint32_t bound)
+    {
+        return static_cast<uint32_t>((static_cast<uint64_t>(bits) * bound) >> 32);
+    }
+
+    static float unit(uint32_t bits)
+    {
+        return (bits >> 8) * (1.0f / 16777216.0f);
+    }
+};
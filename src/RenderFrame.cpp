@@ -0,0 +1,55 @@
+#include "RenderFrame.h"
+
+#include <chrono>
+
+double RenderFrame::now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+size_t RenderFrame::size() const
+{
+    return x.size();
+}
+
+void RenderFrame::resize(size_t shapes)
+{
+    prevX.resize(shapes);
+    prevY.resize(shapes);
+    prevAngle.resize(shapes);
+    x.resize(shapes);
+    y.resize(shapes);
+    angle.resize(shapes);
+    radius.resize(shapes);
+    thickness.resize(shapes);
+    points.resize(shapes);
+    fill.resize(shapes);
+    outline.resize(shapes);
+}
+
+RenderFrame & RenderBuffer::back()
+{
+    return m_frames[m_back];
+}
+
+void RenderBuffer::publish()
+{
+    // Swap the finished frame in as the spare, marked fresh; release makes
+    // its contents visible to the reader that acquires it
+    m_back = m_spare.exchange(m_back | FRESH, std::memory_order_acq_rel) & INDEX;
+}
+
+bool RenderBuffer::acquire()
+{
+    if (!(m_spare.load(std::memory_order_relaxed) & FRESH))
+    {
+        return false;
+    }
+    m_front = m_spare.exchange(m_front, std::memory_order_acq_rel) & INDEX;
+    return true;
+}
+
+const RenderFrame & RenderBuffer::front() const
+{
+    return m_frames[m_front];
+}
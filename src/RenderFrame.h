@@ -0,0 +1,60 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Everything the render thread needs to draw one simulation tick, copied out
+// of the ComponentStore so drawing never reads live simulation state. Entry i
+// of every array is the i-th shape to draw, back to front. The transform of
+// the tick before is kept alongside so drawing can blend between the two.
+struct RenderFrame
+{
+    std::vector<float>      prevX;
+    std::vector<float>      prevY;
+    std::vector<float>      prevAngle;
+    std::vector<float>      x;
+    std::vector<float>      y;
+    std::vector<float>      angle;
+    std::vector<float>      radius;
+    std::vector<float>      thickness;  // outline
+    std::vector<uint32_t>   points;
+    std::vector<sf::Color>  fill;       // lifespan fade already applied
+    std::vector<sf::Color>  outline;
+
+    int         score = 0;
+    bool        showProfile = false;
+    std::string profile;                // the timings overlay, if showProfile
+    double      due = 0.0;              // now() when the tick fell due; blending starts there
+    float       tickSeconds = 1.0f;
+
+    static double now();                // seconds on a steady clock
+
+    size_t size() const;
+    void resize(size_t shapes);         // keeps capacity, so a reused frame stops allocating
+};
+
+// Passes frames from the simulation thread to the render thread without
+// either one waiting for the other: a triple buffer. The writer fills back()
+// and publish()es it; the reader takes the newest published frame with
+// acquire() and may draw front() for as long as it likes. Frames the reader
+// never got to are overwritten. One writer thread and one reader thread.
+class RenderBuffer
+{
+    static const uint8_t INDEX = 3;
+    static const uint8_t FRESH = 4;     // the spare slot holds a frame not yet acquired
+
+    RenderFrame             m_frames[3];
+    std::atomic<uint8_t>    m_spare{1};
+    uint8_t                 m_back = 0;     // the writer's slot
+    uint8_t                 m_front = 2;    // the reader's slot
+
+public:
+    RenderFrame & back();
+    void publish();
+
+    bool acquire();                     // true if front() is now a newer frame
+    const RenderFrame & front() const;
+};
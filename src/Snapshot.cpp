@@ -0,0 +1,450 @@
+#include "Game.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #define SNAPSHOT_MMAP
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+// Snapshot layout, all in the writer's native byte order (checked on load):
+//
+//   Header
+//   tag table      per tag: uint32 length, then the name's bytes
+//   row tags       uint16 TagId per row
+//   tag order      per tag: uint32 count, then the rows of its list in order
+//   columns        every ComponentStore::forEachColumn array, rows [0, n) each
+//   shapes         ShapeRecord per row
+//   input          InputRecord per row
+//
+// Rows are saved in order, so loading rebuilds the same rows and entity list,
+// and the tag order section puts each tag list back in its saved order (it
+// decides e.g. which bullet wins a collision). Handles are new; the player is
+// found again by its row, which must hold a player. Bump SNAPSHOT_VERSION
+// whenever any of this changes.
+namespace
+{
+    const char SNAPSHOT_MAGIC[4] = { 'S', 'N', 'A', 'P' };
+    const uint32_t SNAPSHOT_VERSION = 3;
+    const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    // Far beyond any configured shape; more is a corrupt count that would
+    // have the shape allocate its vertices by it
+    const uint32_t MAX_SHAPE_POINTS = 1024;
+
+    struct Header
+    {
+        char     magic[4];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint32_t columns;           // forEachColumn count, to catch layout drift
+        uint32_t entities;
+        uint32_t tags;
+        uint32_t playerRow;
+        uint32_t seed;
+        uint64_t rngState;          // Random::state / increment, to resume the
+        uint64_t rngIncrement;      // exact sequence rather than restart it
+        int32_t  score;
+        int32_t  currentFrame;
+        int32_t  lastEnemySpawnTime;
+        float    worldWidth;
+        float    worldHeight;
+        uint32_t lifespanTick;      // EntityManager::lifespanTick, the clock lifeExpiry counts in
+    };
+
+    struct ShapeRecord
+    {
+        float    radius;
+        uint32_t points;
+        uint8_t  fill[4];
+        uint8_t  outline[4];
+        float    thickness;
+    };
+
+    struct InputRecord
+    {
+        uint8_t up, down, left, right, shoot;
+    };
+
+    // The bytes of a file: memory-mapped where the platform allows it,
+    // otherwise read in with one call
+    class FileBytes
+    {
+        const char*         m_data = nullptr;
+        size_t              m_size = 0;
+        std::vector<char>   m_buffer;
+#ifdef SNAPSHOT_MMAP
+        void*               m_map = nullptr;
+#endif
+
+    public:
+        ~FileBytes()
+        {
+#ifdef SNAPSHOT_MMAP
+            if (m_map)
+            {
+                munmap(m_map, m_size);
+            }
+#endif
+        }
+
+        bool open(const std::string & path)
+        {
+#ifdef SNAPSHOT_MMAP
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd >= 0)
+            {
+                struct stat st;
+                if (fstat(fd, &st) == 0 && st.st_size > 0)
+                {
+                    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (map != MAP_FAILED)
+                    {
+                        m_map = map;
+                        m_data = static_cast<const char*>(map);
+                        m_size = st.st_size;
+                    }
+                }
+                close(fd);
+                if (m_map)
+                {
+                    return true;
+                }
+            }
+#endif
+            std::ifstream fin(path, std::ios::binary | std::ios::ate);
+            if (!fin)
+            {
+                return false;
+            }
+            m_buffer.resize(static_cast<size_t>(fin.tellg()));
+            fin.seekg(0);
+            fin.read(m_buffer.data(), m_buffer.size());
+            m_data = m_buffer.data();
+            m_size = m_buffer.size();
+            return static_cast<bool>(fin);
+        }
+
+        const char* data() const { return m_data; }
+        size_t size() const { return m_size; }
+    };
+
+    // Sequential reads that fail, rather than overrun, on a truncated file
+    class Reader
+    {
+        const char* m_data;
+        size_t      m_size;
+        size_t      m_offset = 0;
+
+    public:
+        Reader(const char* data, size_t size)
+            : m_data(data), m_size(size) {}
+
+        const char* take(size_t bytes)
+        {
+            if (bytes > m_size - m_offset)
+            {
+                return nullptr;
+            }
+            const char* p = m_data + m_offset;
+            m_offset += bytes;
+            return p;
+        }
+
+        bool read(void* dst, size_t bytes)
+        {
+            const char* p = take(bytes);
+            if (p && bytes > 0)     // dst may be an empty vector's null data()
+            {
+                std::memcpy(dst, p, bytes);
+            }
+            return p != nullptr;
+        }
+    };
+
+    size_t columnCount(ComponentStore & c)
+    {
+        size_t n = 0;
+        c.forEachColumn([&](const char*, void*, size_t) { n++; });
+        return n;
+    }
+}
+
+bool Game::saveSnapshot(const std::string & path)
+{
+    // Fold in recorded commands, then pending and destroyed entities, so the
+    // rows are exactly the committed world. The next tick would start with
+    // this same update().
+    applyCommands();
+    m_entities.update();
+
+    const EntityVec& entities = m_entities.getEntities();
+    ComponentStore& c = m_entities.components();
+    size_t n = entities.size();
+
+    std::ofstream fout(path, std::ios::binary);
+    if (!fout)
+    {
+        std::cout << "could not write snapshot " << path << "\n";
+        return false;
+    }
+
+    Header h;
+    std::memcpy(h.magic, SNAPSHOT_MAGIC, sizeof h.magic);
+    h.version = SNAPSHOT_VERSION;
+    h.byteOrder = BYTE_ORDER_MARK;
+    h.columns = static_cast<uint32_t>(columnCount(c));
+    h.entities = static_cast<uint32_t>(n);
+    h.tags = static_cast<uint32_t>(m_entities.tagCount());
+    h.playerRow = static_cast<uint32_t>(m_entities.row(m_player));
+    h.seed = m_seed;
+    h.rngState = m_rng.state();
+    h.rngIncrement = m_rng.increment();
+    h.score = m_score;
+    h.currentFrame = m_currentFrame;
+    h.lastEnemySpawnTime = m_lastEnemySpawnTime;
+    h.worldWidth = m_worldSize.x;
+    h.worldHeight = m_worldSize.y;
+    h.lifespanTick = m_entities.lifespanTick();
+    fout.write(reinterpret_cast<const char*>(&h), sizeof h);
+
+    for (TagId t = 0; t < h.tags; t++)
+    {
+        const std::string& name = m_entities.tagName(t);
+        uint32_t length = static_cast<uint32_t>(name.size());
+        fout.write(reinterpret_cast<const char*>(&length), sizeof length);
+        fout.write(name.data(), length);
+    }
+
+    std::vector<TagId> rowTags(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        rowTags[i] = m_entities.tagOf(entities[i]);
+    }
+    fout.write(reinterpret_cast<const char*>(rowTags.data()), n * sizeof(TagId));
+
+    std::vector<uint32_t> order;
+    for (TagId t = 0; t < h.tags; t++)
+    {
+        const EntityVec& tagged = m_entities.getEntities(t);
+        order.resize(tagged.size());
+        for (size_t i = 0; i < tagged.size(); i++)
+        {
+            order[i] = static_cast<uint32_t>(m_entities.row(tagged[i]));
+        }
+        uint32_t count = static_cast<uint32_t>(order.size());
+        fout.write(reinterpret_cast<const char*>(&count), sizeof count);
+        fout.write(reinterpret_cast<const char*>(order.data()), count * sizeof(uint32_t));
+    }
+
+    // Each column is already one contiguous block
+    c.forEachColumn([&](const char*, void* data, size_t bytes)
+    {
+        fout.write(static_cast<const char*>(data), n * bytes);
+    });
+
+    std::vector<ShapeRecord> shapes(n);
+    std::vector<InputRecord> input(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        const sf::CircleShape& circle = c.shape[i].circle;
+        sf::Color fill = circle.getFillColor();
+        sf::Color outline = circle.getOutlineColor();
+        shapes[i] = ShapeRecord{ circle.getRadius(), static_cast<uint32_t>(circle.getPointCount()),
+                                 { fill.r, fill.g, fill.b, fill.a },
+                                 { outline.r, outline.g, outline.b, outline.a },
+                                 circle.getOutlineThickness() };
+        const CInput& in = c.input[i];
+        input[i] = InputRecord{ in.up, in.down, in.left, in.right, in.shoot };
+    }
+    fout.write(reinterpret_cast<const char*>(shapes.data()), n * sizeof(ShapeRecord));
+    fout.write(reinterpret_cast<const char*>(input.data()), n * sizeof(InputRecord));
+
+    if (!fout)
+    {
+        std::cout << "could not write snapshot " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool Game::loadSnapshot(const std::string & path)
+{
+    FileBytes file;
+    if (!file.open(path))
+    {
+        std::cout << "no snapshot file " << path << "\n";
+        return false;
+    }
+
+    Reader in(file.data(), file.size());
+    Header h;
+    if (!in.read(&h, sizeof h)
+        || std::memcmp(h.magic, SNAPSHOT_MAGIC, sizeof h.magic) != 0
+        || h.byteOrder != BYTE_ORDER_MARK)
+    {
+        std::cout << "not a snapshot: " << path << "\n";
+        return false;
+    }
+    if (h.version != SNAPSHOT_VERSION || h.columns != columnCount(m_entities.components()))
+    {
+        std::cout << "snapshot version " << h.version << " not supported: " << path << "\n";
+        return false;
+    }
+
+    // Parse and bounds-check everything before touching the world, so a bad
+    // file leaves the game as it was. The counts come first: each tag takes at
+    // least its name length and list count, each row at least rowBytes, so
+    // counts the file cannot hold are rejected before anything is sized by them.
+    size_t n = h.entities;
+    size_t rowBytes = sizeof(TagId) + sizeof(ShapeRecord) + sizeof(InputRecord);
+    m_entities.components().forEachColumn([&](const char*, void*, size_t bytes) { rowBytes += bytes; });
+    uint64_t minBytes = sizeof h + uint64_t(h.tags) * 2 * sizeof(uint32_t) + uint64_t(n) * rowBytes;
+    if (minBytes > file.size())
+    {
+        std::cout << "truncated snapshot: " << path << "\n";
+        return false;
+    }
+
+    // Names stay strings until the file has passed every check, so a rejected
+    // file interns nothing
+    std::vector<std::string> tagNames(h.tags);
+    for (uint32_t t = 0; t < h.tags; t++)
+    {
+        uint32_t length = 0;
+        const char* name = in.read(&length, sizeof length) ? in.take(length) : nullptr;
+        if (!name)
+        {
+            std::cout << "truncated snapshot: " << path << "\n";
+            return false;
+        }
+        tagNames[t].assign(name, length);
+    }
+
+    const char* rowTags = in.take(n * sizeof(TagId));
+    std::vector<std::vector<uint32_t>> tagOrder(h.tags);
+    for (uint32_t t = 0; t < h.tags && rowTags; t++)
+    {
+        uint32_t count = 0;
+        if (!in.read(&count, sizeof count) || count > n)
+        {
+            rowTags = nullptr;
+            break;
+        }
+        tagOrder[t].resize(count);
+        if (!in.read(tagOrder[t].data(), count * sizeof(uint32_t)))
+        {
+            rowTags = nullptr;
+        }
+    }
+    const char* rest = rowTags ? in.take(n * (rowBytes - sizeof(TagId))) : nullptr;
+    if (!rest)
+    {
+        std::cout << "truncated snapshot: " << path << "\n";
+        return false;
+    }
+    const char* shapes = rest + n * (rowBytes - sizeof(TagId) - sizeof(ShapeRecord) - sizeof(InputRecord));
+    if (h.currentFrame < 0 || h.lastEnemySpawnTime < 0 || h.lastEnemySpawnTime > h.currentFrame)
+    {
+        std::cout << "corrupt snapshot: " << path << "\n";
+        return false;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        TagId t;
+        ShapeRecord shape;
+        std::memcpy(&t, rowTags + i * sizeof t, sizeof t);
+        std::memcpy(&shape, shapes + i * sizeof shape, sizeof shape);
+        if (t >= h.tags || shape.points > MAX_SHAPE_POINTS)
+        {
+            std::cout << "corrupt snapshot: " << path << "\n";
+            return false;
+        }
+    }
+
+    // Every game has a player, and systems use m_player without checking it
+    TagId playerTag = 0;
+    if (h.playerRow < n)
+    {
+        std::memcpy(&playerTag, rowTags + h.playerRow * sizeof playerTag, sizeof playerTag);
+    }
+    if (h.playerRow >= n || tagNames[playerTag] != m_entities.tagName(m_playerTag))
+    {
+        std::cout << "snapshot has no player: " << path << "\n";
+        return false;
+    }
+
+    std::vector<TagId> tagIds(h.tags);
+    for (uint32_t t = 0; t < h.tags; t++)
+    {
+        tagIds[t] = m_entities.tagId(tagNames[t]);
+    }
+
+    // Rebuild the rows in order: after clear() the i-th new entity gets row i.
+    // Commands recorded against the old world are dropped with it.
+    m_commands.clear();
+    m_entities.clear();
+    m_entities.reserve(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        TagId t;
+        std::memcpy(&t, rowTags + i * sizeof t, sizeof t);
+        m_entities.addEntity(tagIds[t]);
+    }
+
+    ComponentStore& c = m_entities.components();
+    c.forEachColumn([&](const char*, void* data, size_t bytes)
+    {
+        std::memcpy(data, rest, n * bytes);
+        rest += n * bytes;
+    });
+
+    for (size_t i = 0; i < n; i++)
+    {
+        ShapeRecord s;
+        std::memcpy(&s, rest + i * sizeof s, sizeof s);
+        c.shape[i].set(s.radius, s.points,
+                       sf::Color(s.fill[0], s.fill[1], s.fill[2], s.fill[3]),
+                       sf::Color(s.outline[0], s.outline[1], s.outline[2], s.outline[3]),
+                       s.thickness);
+    }
+    rest += n * sizeof(ShapeRecord);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        InputRecord r;
+        std::memcpy(&r, rest + i * sizeof r, sizeof r);
+        c.input[i].up = r.up;
+        c.input[i].down = r.down;
+        c.input[i].left = r.left;
+        c.input[i].right = r.right;
+        c.input[i].shoot = r.shoot;
+    }
+
+    m_entities.update();
+    m_entities.setLifespanTick(h.lifespanTick);
+    for (uint32_t t = 0; t < h.tags; t++)
+    {
+        if (!m_entities.setTagOrder(tagIds[t], tagOrder[t]))
+        {
+            // The world is loaded; only the iteration order could not be restored
+            std::cout << "snapshot tag order mismatch for '" << m_entities.tagName(tagIds[t]) << "'\n";
+        }
+    }
+    m_player = m_entities.getEntities()[h.playerRow];
+
+    m_score = h.score;
+    m_currentFrame = h.currentFrame;
+    m_lastEnemySpawnTime = h.lastEnemySpawnTime;
+    m_worldSize = Vec2(h.worldWidth, h.worldHeight);
+
+    m_seed = h.seed;
+    m_rng.restore(h.rngState, h.rngIncrement);
+    return true;
+}
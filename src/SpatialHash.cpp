@@ -0,0 +1,103 @@
+#include "SpatialHash.h"
+
+int SpatialHash::cellCoord(float v) const
+{
+    // Clamp before converting so far off-screen positions cannot overflow an int
+    float c = std::floor(v * m_invCellSize);
+    c = std::max(-1.0e9f, std::min(c, 1.0e9f));
+    return static_cast<int>(c);
+}
+
+size_t SpatialHash::bucketOf(int cx, int cy) const
+{
+    uint32_t h = static_cast<uint32_t>(cx) * 73856093u ^ static_cast<uint32_t>(cy) * 19349663u;
+    return h & m_bucketMask;
+}
+
+void SpatialHash::clear(float cellSize)
+{
+    m_cellSize = cellSize > 0.0f ? cellSize : 1.0f;
+    m_invCellSize = 1.0f / m_cellSize;
+    m_pending.clear();
+    m_entries.clear();
+    m_minX = m_minY = 0;
+    m_maxX = m_maxY = -1;
+}
+
+void SpatialHash::insert(size_t item, const Vec2 & pos)
+{
+    Entry entry;
+    entry.cx = cellCoord(pos.x);
+    entry.cy = cellCoord(pos.y);
+    entry.item = item;
+    m_pending.push_back(entry);
+}
+
+void SpatialHash::build()
+{
+    // Two buckets per item keeps chains short; always a power of two for masking
+    size_t buckets = 16;
+    while (buckets < m_pending.size() * 2)
+    {
+        buckets *= 2;
+    }
+    m_bucketMask = buckets - 1;
+    m_bucketStart.assign(buckets + 1, 0);
+
+    if (!m_pending.empty())
+    {
+        m_minX = m_maxX = m_pending[0].cx;
+        m_minY = m_maxY = m_pending[0].cy;
+    }
+
+    // Counting sort by bucket: count, prefix sum, then scatter
+    for (auto& entry : m_pending)
+    {
+        m_bucketStart[bucketOf(entry.cx, entry.cy) + 1]++;
+        m_minX = std::min(m_minX, entry.cx);
+        m_maxX = std::max(m_maxX, entry.cx);
+        m_minY = std::min(m_minY, entry.cy);
+        m_maxY = std::max(m_maxY, entry.cy);
+    }
+    for (size_t b = 0; b < buckets; b++)
+    {
+        m_bucketStart[b + 1] += m_bucketStart[b];
+    }
+
+    // Scatter in insertion order so items within a cell stay in that order
+    m_entries.resize(m_pending.size());
+    for (auto& entry : m_pending)
+    {
+        m_entries[m_bucketStart[bucketOf(entry.cx, entry.cy)]++] = entry;
+    }
+
+    // The scatter advanced every start to the next bucket's start; shift back
+    for (size_t b = buckets; b > 0; b--)
+    {
+        m_bucketStart[b] = m_bucketStart[b - 1];
+    }
+    m_bucketStart[0] = 0;
+
+    m_pending.clear();
+}
+
+float SpatialHash::cellSize() const
+{
+    return m_cellSize;
+}
+
+size_t SpatialHash::size() const
+{
+    return m_entries.size();
+}
+
+float SpatialHash::farthest(const Vec2 & pos) const
+{
+    if (m_entries.empty())
+    {
+        return 0.0f;
+    }
+    float dx = std::max(std::fabs(pos.x - m_minX * m_cellSize), std::fabs(pos.x - (m_maxX + 1) * m_cellSize));
+    float dy = std::max(std::fabs(pos.y - m_minY * m_cellSize), std::fabs(pos.y - (m_maxY + 1) * m_cellSize));
+    return std::sqrt(dx * dx + dy * dy);
+}
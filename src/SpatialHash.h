@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Vec2.h"
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+// Uniform grid broadphase. Items are bucketed by the cell that contains their
+// position, and a query visits only the cells overlapped by a circle's
+// bounding box. The grid is rebuilt from scratch each frame; its storage is
+// kept between builds so steady-state frames do not allocate.
+class SpatialHash
+{
+    struct Entry
+    {
+        int cx = 0;
+        int cy = 0;
+        size_t item = 0;
+    };
+
+    float               m_cellSize = 1.0f;
+    float               m_invCellSize = 1.0f;
+    std::vector<Entry>  m_pending;      // entries inserted since the last build
+    std::vector<Entry>  m_entries;      // entries grouped by bucket
+    std::vector<size_t> m_bucketStart;  // bucket b spans [start[b], start[b+1])
+    size_t              m_bucketMask = 0;
+    int                 m_minX = 0, m_minY = 0, m_maxX = -1, m_maxY = -1;
+
+    int cellCoord(float v) const;
+    size_t bucketOf(int cx, int cy) const;
+
+public:
+    void clear(float cellSize);
+    void insert(size_t item, const Vec2 & pos);
+    void build();
+
+    float cellSize() const;
+    size_t size() const;
+    float farthest(const Vec2 & pos) const; // distance from pos to the far corner of the occupied cells
+
+    // Calls visit(item) once for every item whose cell overlaps the box
+    // around pos with half-extent radius. Callers do their own narrowphase.
+    template <typename F>
+    void query(const Vec2 & pos, float radius, F && visit) const
+    {
+        if (m_entries.empty())
+        {
+            return;
+        }
+
+        // Clip the query box to the occupied cells so huge radii stay cheap
+        int x0 = std::max(cellCoord(pos.x - radius), m_minX);
+        int x1 = std::min(cellCoord(pos.x + radius), m_maxX);
+        int y0 = std::max(cellCoord(pos.y - radius), m_minY);
+        int y1 = std::min(cellCoord(pos.y + radius), m_maxY);
+
+        for (int cy = y0; cy <= y1; cy++)
+        {
+            for (int cx = x0; cx <= x1; cx++)
+            {
+                size_t b = bucketOf(cx, cy);
+                for (size_t i = m_bucketStart[b]; i < m_bucketStart[b + 1]; i++)
+                {
+                    // Several cells can share a bucket; skip the other cells' items
+                    const Entry & entry = m_entries[i];
+                    if (entry.cx == cx && entry.cy == cy)
+                    {
+                        visit(entry.item);
+                    }
+                }
+            }
+        }
+    }
+};
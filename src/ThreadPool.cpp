@@ -0,0 +1,125 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(size_t threads)
+{
+    start(threads);
+}
+
+ThreadPool::~ThreadPool()
+{
+    stop();
+}
+
+void ThreadPool::start(size_t threads)
+{
+    stop();
+
+    if (threads == 0)
+    {
+        threads = std::thread::hardware_concurrency();
+    }
+
+    m_stop = false;
+    for (size_t i = 1; i < threads; i++)
+    {
+        m_workers.emplace_back(&ThreadPool::worker, this);
+    }
+}
+
+void ThreadPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+
+    for (auto& t : m_workers)
+    {
+        t.join();
+    }
+    m_workers.clear();
+}
+
+size_t ThreadPool::size() const
+{
+    return m_workers.size() + 1;
+}
+
+size_t ThreadPool::chunkSize(size_t grain)
+{
+    const size_t lane = CACHE_LINE / sizeof(float);
+    return grain == 0 ? lane : (grain + lane - 1) / lane * lane;
+}
+
+size_t ThreadPool::chunkCount(size_t count, size_t grain)
+{
+    size_t chunk = chunkSize(grain);
+    return (count + chunk - 1) / chunk;
+}
+
+void ThreadPool::worker()
+{
+    uint64_t seen = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+            if (m_stop)
+            {
+                return;
+            }
+            seen = m_generation;
+            m_active++;
+        }
+
+        work();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_active--;
+        }
+        m_idle.notify_all();
+    }
+}
+
+void ThreadPool::work()
+{
+    for (size_t i = m_next++; i < m_chunks; i = m_next++)
+    {
+        m_run(m_context, i);
+    }
+}
+
+void ThreadPool::run(size_t chunks, void (*fn)(void*, size_t), void* context)
+{
+    // Nothing to share: skip the wake-up round trip
+    if (chunks <= 1 || m_workers.empty())
+    {
+        for (size_t i = 0; i < chunks; i++)
+        {
+            fn(context, i);
+        }
+        return;
+    }
+
+    {
+        // A worker that woke late for the previous job may still be inside
+        // work(); let it leave before the job fields change under it
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idle.wait(lock, [&] { return m_active == 0; });
+        m_run = fn;
+        m_context = context;
+        m_chunks = chunks;
+        m_next = 0;
+        m_generation++;
+    }
+    m_wake.notify_all();
+
+    work();
+
+    // Every chunk has been claimed; wait for the workers still running one
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [&] { return m_active == 0; });
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads for data-parallel loops. parallelFor() splits
+// [0, count) into chunks of 'grain' items, rounded up to whole cache lines of
+// floats so neighbouring chunks never write to the same line of a component
+// array. The calling thread works alongside the workers and parallelFor()
+// returns once every chunk has run.
+//
+// Chunk boundaries depend only on count and grain, never on the thread count
+// or on which thread runs which chunk, so any per-chunk results merged in
+// chunk order are identical however many threads there are.
+class ThreadPool
+{
+    std::vector<std::thread>    m_workers;
+    std::mutex                  m_mutex;
+    std::condition_variable     m_wake;         // a new job is ready, or stop
+    std::condition_variable     m_idle;         // a worker left the current job
+    uint64_t                    m_generation = 0;
+    size_t                      m_active = 0;   // workers inside work()
+    bool                        m_stop = false;
+
+    // The current job
+    void                      (*m_run)(void*, size_t) = nullptr;
+    void*                       m_context = nullptr;
+    size_t                      m_chunks = 0;
+    std::atomic<size_t>         m_next{0};
+
+    void worker();
+    void work();
+    void run(size_t chunks, void (*fn)(void*, size_t), void* context);
+    void stop();
+
+public:
+    static const size_t CACHE_LINE = 64;
+
+    // threads counts the calling thread; 0 means one per hardware thread
+    explicit ThreadPool(size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool & operator=(const ThreadPool &) = delete;
+
+    void start(size_t threads);     // replace the workers, same meaning as the constructor
+    size_t size() const;            // threads including the caller
+
+    // Chunk size for 'grain' items of 4-byte fields, rounded up to a cache line
+    static size_t chunkSize(size_t grain);
+    static size_t chunkCount(size_t count, size_t grain);
+
+    // Calls fn(chunk, begin, end) for every chunk of [0, count)
+    template <typename F>
+    void parallelFor(size_t count, size_t grain, F && fn)
+    {
+        size_t chunk = chunkSize(grain);
+        size_t chunks = chunkCount(count, grain);
+        auto job = [&](size_t i)
+        {
+            size_t begin = i * chunk;
+            fn(i, begin, begin + chunk < count ? begin + chunk : count);
+        };
+        run(chunks, [](void* context, size_t i) { (*static_cast<decltype(job)*>(context))(i); }, &job);
+    }
+
+    // Calls fn(i) for every i in [0, count), each as a chunk of its own: for
+    // a few large independent tasks, such as whole simulations, that whole
+    // cache lines of them per chunk would balance badly
+    template <typename F>
+    void forEach(size_t count, F && fn)
+    {
+        auto job = [&](size_t i) { fn(i); };
+        run(count, [](void* context, size_t i) { (*static_cast<decltype(job)*>(context))(i); }, &job);
+    }
+};
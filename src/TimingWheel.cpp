@@ -0,0 +1,139 @@
+#include "TimingWheel.h"
+
+#include <algorithm>
+
+const uint32_t TimingWheel::NOWHERE;
+
+TimingWheel::TimingWheel()
+    : m_buckets(LEVELS * BUCKETS)
+{
+}
+
+uint32_t TimingWheel::now() const
+{
+    return m_now;
+}
+
+size_t TimingWheel::size() const
+{
+    return m_size;
+}
+
+Memory::Usage TimingWheel::memory() const
+{
+    Memory::Usage u{ "lifespan wheel", m_size,
+                     m_size * sizeof(Entry) + m_where.size() * sizeof(uint32_t),
+                     m_buckets.capacity() * sizeof(m_buckets[0])
+                     + m_where.capacity() * sizeof(uint32_t) + m_moving.capacity() * sizeof(Entry) };
+    for (const auto& bucket : m_buckets)
+    {
+        u.reserved += bucket.capacity() * sizeof(Entry);
+    }
+    return u;
+}
+
+void TimingWheel::reset(uint32_t now)
+{
+    for (auto& bucket : m_buckets)
+    {
+        bucket.clear();
+    }
+    std::fill(m_where.begin(), m_where.end(), NOWHERE);
+    m_now = now;
+    m_size = 0;
+}
+
+void TimingWheel::place(const Entry & entry)
+{
+    // The level is picked by distance, the bucket within it by the due tick's
+    // digit at that level, so a bucket holds one window of due ticks
+    uint32_t due = static_cast<int32_t>(entry.due - m_now) < 0 ? m_now : entry.due;
+    uint32_t distance = due - m_now;
+    uint32_t level = 0;
+    while (level + 1 < LEVELS && distance >= (1u << (BUCKET_BITS * (level + 1))))
+    {
+        level++;
+    }
+    uint32_t bucket = level * BUCKETS + ((due >> (BUCKET_BITS * level)) & (BUCKETS - 1));
+
+    uint32_t slot = entry.entity.slot();
+    if (slot >= m_where.size())
+    {
+        m_where.resize(slot + 1, NOWHERE);
+    }
+    m_where[slot] = (bucket << Entity::INDEX_BITS) | static_cast<uint32_t>(m_buckets[bucket].size());
+    m_buckets[bucket].push_back(entry);
+}
+
+void TimingWheel::schedule(Entity entity, uint32_t due)
+{
+    cancel(entity);
+    place({ entity, due });
+    m_size++;
+}
+
+void TimingWheel::cancel(Entity entity)
+{
+    uint32_t slot = entity.slot();
+    if (slot >= m_where.size() || m_where[slot] == NOWHERE)
+    {
+        return;
+    }
+    uint32_t bucket = m_where[slot] >> Entity::INDEX_BITS;
+    uint32_t index = m_where[slot] & (Entity::MAX_SLOTS - 1);
+    std::vector<Entry>& entries = m_buckets[bucket];
+    if (entries[index].entity != entity)
+    {
+        return;     // a stale handle; the entry belongs to the slot's new entity
+    }
+
+    // Swap-and-pop, keeping the moved entry's position up to date
+    if (index != entries.size() - 1)
+    {
+        entries[index] = entries.back();
+        m_where[entries[index].entity.slot()] = (bucket << Entity::INDEX_BITS) | index;
+    }
+    entries.pop_back();
+    m_where[slot] = NOWHERE;
+    m_size--;
+}
+
+void TimingWheel::cascade(uint32_t level)
+{
+    // Swap the bucket out first: entries placed back into the same bucket
+    // (due a whole revolution later) must not be visited again
+    uint32_t bucket = level * BUCKETS + ((m_now >> (BUCKET_BITS * level)) & (BUCKETS - 1));
+    m_moving.swap(m_buckets[bucket]);
+    for (const Entry& entry : m_moving)
+    {
+        place(entry);
+    }
+    m_moving.clear();
+}
+
+void TimingWheel::advance(std::vector<Entry> & due)
+{
+    // When a level's window rolls over, move the next window of the level
+    // above down into it, highest level first so entries can fall through
+    // several levels in one tick
+    if ((m_now & (BUCKETS - 1)) == 0)
+    {
+        for (uint32_t level = LEVELS - 1; level > 0; level--)
+        {
+            if ((m_now & ((1u << (BUCKET_BITS * level)) - 1)) == 0)
+            {
+                cascade(level);
+            }
+        }
+    }
+
+    std::vector<Entry>& entries = m_buckets[m_now & (BUCKETS - 1)];
+    for (const Entry& entry : entries)
+    {
+        m_where[entry.entity.slot()] = NOWHERE;
+        due.push_back(entry);
+    }
+    m_size -= entries.size();
+    entries.clear();
+    m_now++;
+}
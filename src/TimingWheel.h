@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Entity.h"
+#include "Memory.h"
+#include <vector>
+#include <cstdint>
+
+// A hierarchical timing wheel of entity deadlines, in ticks.
+// Four levels of 256 buckets cover every 32-bit distance: level 0 has one
+// bucket per tick for deadlines under 256 ticks away, level 1 one bucket per
+// 256 ticks for deadlines under 65536 away, and so on. advance() empties one
+// level 0 bucket per tick, and each time a level's window rolls over it
+// redistributes one bucket of the level above. Each entry is therefore
+// touched at most once per level, so a tick costs in proportion to the
+// entries due or moving down, however many are scheduled.
+//
+// Each entity has at most one entry, and cancel() removes it in O(1), so
+// entities removed early leave nothing behind.
+class TimingWheel
+{
+public:
+    struct Entry
+    {
+        Entity      entity;
+        uint32_t    due;
+    };
+
+private:
+    static const uint32_t LEVELS = 4;
+    static const uint32_t BUCKET_BITS = 8;
+    static const uint32_t BUCKETS = 1u << BUCKET_BITS;
+    static const uint32_t NOWHERE = 0xFFFFFFFFu;
+
+    std::vector<std::vector<Entry>> m_buckets;  // LEVELS * BUCKETS, level-major
+    std::vector<uint32_t>   m_where;    // per entity slot: bucket << Entity::INDEX_BITS | index
+    std::vector<Entry>      m_moving;   // a bucket being redistributed
+    uint32_t                m_now = 0;
+    size_t                  m_size = 0;
+
+    void place(const Entry & entry);
+    void cascade(uint32_t level);
+
+public:
+    TimingWheel();
+
+    uint32_t now() const;               // the tick the next advance() handles
+    size_t size() const;                // entries scheduled
+    Memory::Usage memory() const;       // the buckets and the per-slot index
+    void reset(uint32_t now);           // drop every entry and restart the clock at now
+
+    // Due ticks already passed count as now(). Rescheduling an entity
+    // replaces its earlier entry.
+    void schedule(Entity entity, uint32_t due);
+    void cancel(Entity entity);
+
+    // Appends the entries due at now(), then moves on to the next tick
+    void advance(std::vector<Entry> & due);
+};
@@ -67,6 +67,13 @@ float Vec2::dist(const Vec2 & rhs) const
     return std::sqrtf(dx * dx + dy * dy);
 }
 
+float Vec2::distSq(const Vec2 & rhs) const
+{
+    float dx = rhs.x - this->x;
+    float dy = rhs.y - this->y;
+    return dx * dx + dy * dy;
+}
+
 void Vec2::normalize()
 {
     float length = std::sqrtf(x*x + y*y);
@@ -23,6 +23,7 @@ public:
     void operator /= (const float val);  
 
     float dist(const Vec2 & rhs) const;
+    float distSq(const Vec2 & rhs) const;
     void normalize();
     double length();
     Vec2 spin(float angle);
@@ -0,0 +1,577 @@
+#include "WorldStream.h"
+#include "Entity.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#ifndef _WIN32
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+    #define MSG_NOSIGNAL 0      // SO_NOSIGPIPE is set on the socket instead
+#endif
+
+namespace
+{
+    const uint8_t MAGIC[4] = { 'W', 'S', 'T', 'R' };
+
+    const uint8_t KEY = 1;      // frame flag
+
+    // Which fields a record carries
+    const uint8_t X = 1 << 0;
+    const uint8_t Y = 1 << 1;
+    const uint8_t ANGLE = 1 << 2;
+    const uint8_t ALPHA = 1 << 3;
+    const uint8_t RGB = 1 << 4;
+    const uint8_t NEW = 1 << 7;     // tag and every field, absolute
+
+    uint32_t slotOf(uint32_t id)
+    {
+        return id & (Entity::MAX_SLOTS - 1);
+    }
+
+    // LEB128: seven bits per byte, low bits first
+    void putVarint(std::vector<uint8_t> & out, uint32_t v)
+    {
+        while (v >= 0x80)
+        {
+            out.push_back(static_cast<uint8_t>(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(v));
+    }
+
+    // Small differences of either sign as small unsigned numbers
+    uint32_t zigzag(int32_t v)
+    {
+        return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31);
+    }
+
+    int32_t unzigzag(uint32_t v)
+    {
+        return static_cast<int32_t>(v >> 1) ^ -static_cast<int32_t>(v & 1);
+    }
+
+    void putU32(uint8_t* out, uint32_t v)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            out[i] = static_cast<uint8_t>(v >> (8 * i));
+        }
+    }
+
+    // Bounds-checked reads; any read past the end leaves ok false
+    struct Reader
+    {
+        const uint8_t*  p;
+        const uint8_t*  end;
+        bool            ok = true;
+
+        uint8_t byte()
+        {
+            if (p == end)
+            {
+                ok = false;
+                return 0;
+            }
+            return *p++;
+        }
+
+        uint32_t varint()
+        {
+            uint32_t v = 0;
+            for (int shift = 0; shift < 35; shift += 7)
+            {
+                uint8_t b = byte();
+                v |= static_cast<uint32_t>(b & 0x7F) << shift;
+                if (!(b & 0x80))
+                {
+                    return v;
+                }
+            }
+            ok = false;
+            return 0;
+        }
+    };
+}
+
+void StreamEncoder::setTags(const std::vector<std::string> & names)
+{
+    m_tagNames = names;
+    m_key = true;
+}
+
+void StreamEncoder::reset()
+{
+    m_key = true;
+}
+
+void StreamEncoder::encode(const StreamFrame & frame, std::vector<uint8_t> & out)
+{
+    // Frame numbers mark which slots were in the previous frame; zero is
+    // never used, so a fresh m_seen entry means absent
+    m_frame++;
+    if (m_frame == 0)
+    {
+        m_frame = 1;
+        m_key = true;
+        std::fill(m_seen.begin(), m_seen.end(), 0);
+    }
+
+    m_records.clear();
+    uint32_t records = 0;
+    for (const StreamEntity& e : frame.entities)
+    {
+        uint32_t slot = slotOf(e.id);
+        if (slot >= m_prev.size())
+        {
+            m_prev.resize(slot + 1);
+            m_seen.resize(slot + 1, 0);
+        }
+        StreamEntity& p = m_prev[slot];
+        bool known = !m_key && m_seen[slot] == m_frame - 1 && p.id == e.id;
+
+        uint8_t fields = NEW;
+        if (known)
+        {
+            fields = (e.x != p.x ? X : 0) | (e.y != p.y ? Y : 0) | (e.angle != p.angle ? ANGLE : 0)
+                   | (e.rgba[3] != p.rgba[3] ? ALPHA : 0)
+                   | (std::memcmp(e.rgba, p.rgba, 3) != 0 ? RGB : 0);
+        }
+
+        if (fields)
+        {
+            putVarint(m_records, e.id);
+            m_records.push_back(fields);
+            if (fields & NEW)
+            {
+                putVarint(m_records, e.tag);
+                putVarint(m_records, zigzag(e.x));
+                putVarint(m_records, zigzag(e.y));
+                putVarint(m_records, e.angle);
+                m_records.insert(m_records.end(), e.rgba, e.rgba + 4);
+            } else
+            {
+                // Angles wrap, so their difference is taken mod 65536
+                if (fields & X) putVarint(m_records, zigzag(e.x - p.x));
+                if (fields & Y) putVarint(m_records, zigzag(e.y - p.y));
+                if (fields & ANGLE) putVarint(m_records, zigzag(static_cast<int16_t>(e.angle - p.angle)));
+                if (fields & ALPHA) m_records.push_back(e.rgba[3]);
+                if (fields & RGB) m_records.insert(m_records.end(), e.rgba, e.rgba + 3);
+            }
+            records++;
+        }
+
+        p = e;
+        m_seen[slot] = m_frame;
+    }
+
+    // Whatever was in the previous frame and is not in this one went away;
+    // a key frame replaces everything, so it lists nothing
+    m_removed.clear();
+    uint32_t removed = 0;
+    if (!m_key)
+    {
+        for (uint32_t id : m_prevIds)
+        {
+            uint32_t slot = slotOf(id);
+            if (m_seen[slot] != m_frame || m_prev[slot].id != id)
+            {
+                putVarint(m_removed, id);
+                removed++;
+            }
+        }
+    }
+    m_prevIds.clear();
+    for (const StreamEntity& e : frame.entities)
+    {
+        m_prevIds.push_back(e.id);
+    }
+
+    out.assign(4, 0);
+    putVarint(out, frame.tick);
+    out.push_back(m_key ? KEY : 0);
+    if (m_key)
+    {
+        putVarint(out, static_cast<uint32_t>(m_tagNames.size()));
+        for (const std::string& name : m_tagNames)
+        {
+            putVarint(out, static_cast<uint32_t>(name.size()));
+            out.insert(out.end(), name.begin(), name.end());
+        }
+    }
+    putVarint(out, removed);
+    out.insert(out.end(), m_removed.begin(), m_removed.end());
+    putVarint(out, records);
+    out.insert(out.end(), m_records.begin(), m_records.end());
+    putU32(out.data(), static_cast<uint32_t>(out.size() - 4));
+    m_key = false;
+}
+
+const uint32_t StreamDecoder::NONE;
+
+bool StreamDecoder::header(const uint8_t* data, size_t size)
+{
+    uint32_t version = 0;
+    if (size >= 8)
+    {
+        version = data[4] | data[5] << 8 | data[6] << 16 | static_cast<uint32_t>(data[7]) << 24;
+    }
+    return size >= 8 && std::memcmp(data, MAGIC, 4) == 0 && version == WorldStream::VERSION;
+}
+
+void StreamDecoder::remove(uint32_t id)
+{
+    // Swap-and-pop, keeping the moved entity's index current
+    uint32_t slot = slotOf(id);
+    if (slot >= m_index.size() || m_index[slot] == NONE || m_entities[m_index[slot]].id != id)
+    {
+        return;
+    }
+    uint32_t i = m_index[slot];
+    m_entities[i] = m_entities.back();
+    m_index[slotOf(m_entities[i].id)] = i;
+    m_entities.pop_back();
+    m_index[slot] = NONE;
+}
+
+StreamEntity & StreamDecoder::find(uint32_t id, bool & added)
+{
+    uint32_t slot = slotOf(id);
+    if (slot >= m_index.size())
+    {
+        m_index.resize(slot + 1, NONE);
+    }
+    added = m_index[slot] == NONE;
+    if (added)
+    {
+        m_index[slot] = static_cast<uint32_t>(m_entities.size());
+        m_entities.emplace_back();
+    }
+    return m_entities[m_index[slot]];
+}
+
+bool StreamDecoder::decode(const uint8_t* data, size_t size)
+{
+    Reader in{ data, data + size };
+    uint32_t tick = in.varint();
+    uint8_t flags = in.byte();
+    if (flags & KEY)
+    {
+        // Each name takes at least its length byte, so a count beyond the
+        // bytes left is corrupt. The table is parsed aside and the old state
+        // kept until it is whole.
+        uint32_t tags = in.varint();
+        if (!in.ok || tags > static_cast<size_t>(in.end - in.p))
+        {
+            return false;
+        }
+        std::vector<std::string> names(tags);
+        for (std::string& name : names)
+        {
+            uint32_t length = in.varint();
+            if (!in.ok || length > static_cast<size_t>(in.end - in.p))
+            {
+                return false;
+            }
+            name.assign(reinterpret_cast<const char*>(in.p), length);
+            in.p += length;
+        }
+        m_tagNames.swap(names);
+        m_entities.clear();
+        std::fill(m_index.begin(), m_index.end(), NONE);
+        m_synced = true;
+    }
+    if (!m_synced)
+    {
+        return false;
+    }
+
+    for (uint32_t n = in.varint(); n > 0 && in.ok; n--)
+    {
+        remove(in.varint());
+    }
+
+    for (uint32_t n = in.varint(); n > 0 && in.ok; n--)
+    {
+        uint32_t id = in.varint();
+        uint8_t fields = in.byte();
+        if (!in.ok)
+        {
+            return false;
+        }
+
+        // A new id in a slot replaces whatever the slot held
+        bool added = false;
+        StreamEntity& e = find(id, added);
+        if (!added && e.id != id && !(fields & NEW))
+        {
+            return false;
+        }
+        if (added && !(fields & NEW))
+        {
+            return false;
+        }
+        e.id = id;
+
+        if (fields & NEW)
+        {
+            e.tag = static_cast<uint16_t>(in.varint());
+            e.x = unzigzag(in.varint());
+            e.y = unzigzag(in.varint());
+            e.angle = static_cast<uint16_t>(in.varint());
+            for (uint8_t& b : e.rgba)
+            {
+                b = in.byte();
+            }
+            continue;
+        }
+        if (fields & X) e.x += unzigzag(in.varint());
+        if (fields & Y) e.y += unzigzag(in.varint());
+        if (fields & ANGLE) e.angle = static_cast<uint16_t>(e.angle + unzigzag(in.varint()));
+        if (fields & ALPHA) e.rgba[3] = in.byte();
+        if (fields & RGB)
+        {
+            for (int i = 0; i < 3; i++)
+            {
+                e.rgba[i] = in.byte();
+            }
+        }
+    }
+
+    m_tick = tick;
+    return in.ok && in.p == in.end;
+}
+
+uint32_t StreamDecoder::tick() const
+{
+    return m_tick;
+}
+
+const std::vector<StreamEntity> & StreamDecoder::entities() const
+{
+    return m_entities;
+}
+
+const std::string & StreamDecoder::tagName(uint16_t tag) const
+{
+    static const std::string unknown;
+    return tag < m_tagNames.size() ? m_tagNames[tag] : unknown;
+}
+
+WorldStream::~WorldStream()
+{
+    close();
+}
+
+bool WorldStream::isOpen() const
+{
+    return m_running;
+}
+
+StreamFrame * WorldStream::back()
+{
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_head.load(std::memory_order_acquire) >= QUEUE)
+    {
+        m_dropped++;
+        return nullptr;
+    }
+    return &m_frames[tail % QUEUE];
+}
+
+void WorldStream::publish()
+{
+    // Release hands the filled frame to the sender, which acquires m_tail
+    m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    m_published++;
+    m_ready.notify_one();
+}
+
+WorldStream::Stats WorldStream::stats() const
+{
+    Stats s;
+    s.published = m_published;
+    s.dropped = m_dropped;
+    s.sent = m_sent;
+    s.bytes = m_bytes;
+    s.clients = m_clients;
+    return s;
+}
+
+#ifdef _WIN32
+
+bool WorldStream::open(const std::string &, const std::vector<std::string> &)
+{
+    std::cout << "world streaming needs Unix domain sockets\n";
+    return false;
+}
+
+void WorldStream::close() {}
+void WorldStream::sender() {}
+bool WorldStream::accept(int) { return false; }
+bool WorldStream::send(const uint8_t*, size_t) { return false; }
+void WorldStream::disconnect() {}
+
+#else
+
+bool WorldStream::open(const std::string & path, const std::vector<std::string> & tagNames)
+{
+    close();
+
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof addr.sun_path)
+    {
+        std::cout << "bad stream socket path: " << path << "\n";
+        return false;
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size());
+
+    m_listen = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ::unlink(path.c_str());
+    if (m_listen < 0
+        || ::bind(m_listen, reinterpret_cast<sockaddr*>(&addr), sizeof addr) != 0
+        || ::listen(m_listen, 1) != 0)
+    {
+        std::cout << "could not listen on " << path << ": " << std::strerror(errno) << "\n";
+        if (m_listen >= 0)
+        {
+            ::close(m_listen);
+            m_listen = -1;
+        }
+        return false;
+    }
+
+    m_path = path;
+    m_encoder.setTags(tagNames);
+    m_head = 0;
+    m_tail = 0;
+    m_running = true;
+    m_thread = std::thread(&WorldStream::sender, this);
+    return true;
+}
+
+void WorldStream::close()
+{
+    if (!m_running)
+    {
+        return;
+    }
+    m_running = false;
+    m_ready.notify_one();
+    m_thread.join();
+
+    disconnect();
+    ::close(m_listen);
+    m_listen = -1;
+    ::unlink(m_path.c_str());
+}
+
+void WorldStream::sender()
+{
+    while (m_running)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        bool pending = head != m_tail.load(std::memory_order_acquire);
+
+        // Only poll for a spectator for long while there is nothing to drop
+        if (m_client < 0 && accept(pending ? 0 : 20))
+        {
+            uint8_t header[8];
+            std::memcpy(header, MAGIC, 4);
+            putU32(header + 4, VERSION);
+            m_encoder.reset();
+            if (!send(header, sizeof header))
+            {
+                disconnect();
+            }
+        }
+
+        if (!pending)
+        {
+            if (m_client >= 0)
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_ready.wait_for(lock, std::chrono::milliseconds(20));
+            }
+            continue;
+        }
+
+        if (m_client >= 0)
+        {
+            m_encoder.encode(m_frames[head % QUEUE], m_buffer);
+            if (send(m_buffer.data(), m_buffer.size()))
+            {
+                m_sent++;
+            } else
+            {
+                disconnect();
+            }
+        }
+        m_head.store(head + 1, std::memory_order_release);
+    }
+}
+
+bool WorldStream::accept(int timeoutMs)
+{
+    pollfd p = { m_listen, POLLIN, 0 };
+    if (::poll(&p, 1, timeoutMs) <= 0)
+    {
+        return false;
+    }
+    m_client = ::accept(m_listen, nullptr, nullptr);
+    if (m_client < 0)
+    {
+        return false;
+    }
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    ::setsockopt(m_client, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof on);
+#endif
+    ::fcntl(m_client, F_SETFL, ::fcntl(m_client, F_GETFL) | O_NONBLOCK);
+    m_clients++;
+    return true;
+}
+
+bool WorldStream::send(const uint8_t* data, size_t size)
+{
+    // Non-blocking, so a stalled spectator cannot hold up close()
+    while (size > 0 && m_running)
+    {
+        ssize_t n = ::send(m_client, data, size, MSG_NOSIGNAL);
+        if (n > 0)
+        {
+            data += n;
+            size -= n;
+            m_bytes += n;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        {
+            pollfd p = { m_client, POLLOUT, 0 };
+            ::poll(&p, 1, 20);
+        } else
+        {
+            return false;
+        }
+    }
+    return size == 0;
+}
+
+void WorldStream::disconnect()
+{
+    if (m_client >= 0)
+    {
+        ::close(m_client);
+        m_client = -1;
+    }
+}
+
+#endif
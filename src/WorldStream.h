@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Live world state for a spectator process on the same machine: every tick,
+// each drawn entity's id, tag, position, angle and colour, sent over a Unix
+// domain socket.
+//
+// The stream starts with an 8-byte header ("WSTR", then the version as a
+// little-endian uint32) and continues with frames, each a little-endian
+// uint32 byte count and that many bytes. A frame is delta-encoded against
+// the one before it: only entities that appeared or changed are listed,
+// only their changed fields are sent, as varint differences, and entities
+// that went away are listed by id. Key frames carry everything, plus the
+// tag names, and come first on every connection.
+struct StreamEntity
+{
+    static const int POSITION_SCALE = 16;   // x and y are in 1/16 px
+
+    uint32_t    id = 0;         // Entity::id()
+    uint16_t    tag = 0;        // a TagId; see StreamDecoder::tagName()
+    int32_t     x = 0;
+    int32_t     y = 0;
+    uint16_t    angle = 0;      // 1/65536 of a turn
+    uint8_t     rgba[4] = {};   // fill colour, lifespan fade applied to alpha
+};
+
+struct StreamFrame
+{
+    uint32_t                    tick = 0;
+    std::vector<StreamEntity>   entities;
+};
+
+// Turns frames into the wire format. Keeps the previous frame's entities by
+// slot, so encoding costs in proportion to the entities sent, not to ids.
+class StreamEncoder
+{
+    std::vector<std::string>    m_tagNames;
+    std::vector<StreamEntity>   m_prev;         // by slot
+    std::vector<uint32_t>       m_seen;         // by slot: the frame number it was last in
+    std::vector<uint32_t>       m_prevIds;      // in the previous frame, in order
+    std::vector<uint8_t>        m_records;
+    std::vector<uint8_t>        m_removed;
+    uint32_t                    m_frame = 0;
+    bool                        m_key = true;
+
+public:
+    void setTags(const std::vector<std::string> & names);
+    void reset();               // the next frame is a key frame
+
+    // Replaces out with the frame, length prefix included
+    void encode(const StreamFrame & frame, std::vector<uint8_t> & out);
+};
+
+// Rebuilds the world from frames, as a spectator sees it
+class StreamDecoder
+{
+    std::vector<std::string>    m_tagNames;
+    std::vector<StreamEntity>   m_entities;
+    std::vector<uint32_t>       m_index;        // by slot: position in m_entities, or NONE
+    uint32_t                    m_tick = 0;
+    bool                        m_synced = false;   // a key frame has been seen
+
+    static const uint32_t NONE = 0xFFFFFFFFu;
+
+    void remove(uint32_t id);
+    StreamEntity & find(uint32_t id, bool & added);
+
+public:
+    static bool header(const uint8_t* data, size_t size);      // checks the 8-byte stream header
+
+    // One frame's bytes, without the length prefix. False if they are
+    // malformed or a delta arrives before any key frame.
+    bool decode(const uint8_t* data, size_t size);
+
+    uint32_t tick() const;
+    const std::vector<StreamEntity> & entities() const;     // in no particular order
+    const std::string & tagName(uint16_t tag) const;        // empty for unknown tags
+};
+
+// Streams frames from the simulation thread to one spectator at a time.
+// The simulation fills back() and publish()es it; a background thread
+// encodes and sends. The queue between them is a bounded ring of frames
+// whose storage is reused, and back() returns nullptr rather than wait when
+// it is full, so a slow or stalled spectator costs frames, never ticks.
+// Frames published while no spectator is connected are dropped unencoded.
+class WorldStream
+{
+public:
+    static const uint32_t VERSION = 1;
+
+    struct Stats
+    {
+        size_t published = 0;
+        size_t dropped = 0;     // queue full
+        size_t sent = 0;
+        size_t bytes = 0;       // sent, headers included
+        size_t clients = 0;     // connections accepted
+    };
+
+private:
+    static const size_t QUEUE = 8;
+
+    StreamFrame             m_frames[QUEUE];
+    std::atomic<size_t>     m_head{0};      // next frame to send (sender thread)
+    std::atomic<size_t>     m_tail{0};      // next frame to fill (simulation thread)
+    std::mutex              m_mutex;
+    std::condition_variable m_ready;
+    std::atomic<bool>       m_running{false};
+    std::thread             m_thread;
+    int                     m_listen = -1;
+    int                     m_client = -1;
+    std::string             m_path;
+    StreamEncoder           m_encoder;
+    std::vector<uint8_t>    m_buffer;
+
+    std::atomic<size_t>     m_published{0};
+    std::atomic<size_t>     m_dropped{0};
+    std::atomic<size_t>     m_sent{0};
+    std::atomic<size_t>     m_bytes{0};
+    std::atomic<size_t>     m_clients{0};
+
+    void sender();
+    bool accept(int timeoutMs);
+    bool send(const uint8_t* data, size_t size);
+    void disconnect();
+
+public:
+    ~WorldStream();
+
+    // Listens on a Unix domain socket at path, replacing any stale socket
+    // file there. False, with a message, if it cannot.
+    bool open(const std::string & path, const std::vector<std::string> & tagNames);
+    void close();
+    bool isOpen() const;
+
+    StreamFrame * back();       // the frame to fill, or nullptr to skip this one
+    void publish();
+    Stats stats() const;
+};
@@ -1,8 +1,106 @@
 #include <SFML/Graphics.hpp>
 #include "Game.h"
+#include "Batch.h"
 
-int main()
+#include <string>
+#include <cstdlib>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+int main(int argc, char* argv[])
 {
-    Game g("config.txt");
-    g.run();
+    // game [--headless [frames]] [--seed n] [--record log] [--replay log]
+    //      [--load snapshot] [--save snapshot] [--stream socket]
+    // game --batch jobs [--threads n]
+    //
+    // --record logs every tick's input with where it started; --replay runs
+    // such a log headless, bit-identically, and reports its timings. A log
+    // recorded after --load replays only after loading the same snapshot.
+    // --batch runs every job in the file (see Batch::read) as its own
+    // windowless game, n at a time (0, the default, is one per core), and
+    // prints the results.
+    // --stream serves the world every tick to one spectator at a time on a
+    // Unix domain socket (see WorldStream)
+    bool headless = false;
+    int frames = 10000;
+    std::string load, save, record, replay, seed, batch, stream;
+    size_t threads = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--headless")
+        {
+            headless = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+            {
+                frames = std::atoi(argv[++i]);
+            }
+        }
+        else if (arg == "--load" && i + 1 < argc) load = argv[++i];
+        else if (arg == "--save" && i + 1 < argc) save = argv[++i];
+        else if (arg == "--seed" && i + 1 < argc) seed = argv[++i];
+        else if (arg == "--record" && i + 1 < argc) record = argv[++i];
+        else if (arg == "--replay" && i + 1 < argc) replay = argv[++i];
+        else if (arg == "--batch" && i + 1 < argc) batch = argv[++i];
+        else if (arg == "--stream" && i + 1 < argc) stream = argv[++i];
+        else if (arg == "--threads" && i + 1 < argc) threads = std::strtoul(argv[++i], nullptr, 10);
+    }
+
+    if (!batch.empty())
+    {
+        std::ifstream in(batch);
+        std::vector<BatchJob> jobs;
+        if (!Batch::read(in, jobs))
+        {
+            std::cout << "no jobs in " << batch << "\n";
+            return 1;
+        }
+        ThreadPool pool(threads);
+        std::vector<BatchResult> results;
+        auto start = std::chrono::steady_clock::now();
+        Batch::run(jobs, pool, results);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        Batch::report(std::cout, jobs, results, seconds, pool.size());
+        return 0;
+    }
+
+    Game g("config.txt", headless || !replay.empty());
+    if (!seed.empty())
+    {
+        g.setSeed(static_cast<unsigned int>(std::strtoul(seed.c_str(), nullptr, 10)));
+    }
+    if (!load.empty() && !g.loadSnapshot(load))
+    {
+        return 1;
+    }
+    if (!replay.empty() && !g.replay(replay))
+    {
+        return 1;
+    }
+    if (!record.empty() && !g.record(record))
+    {
+        return 1;
+    }
+    if (!stream.empty() && !g.stream(stream))
+    {
+        return 1;
+    }
+
+    if (!replay.empty())
+    {
+        g.runReplay();
+    } else if (headless)
+    {
+        g.runHeadless(frames);
+    } else
+    {
+        g.run();
+    }
+
+    if (!save.empty() && !g.saveSnapshot(save))
+    {
+        return 1;
+    }
+    return 0;
 }
@@ -0,0 +1,342 @@
+#include "../src/Game.h"
+#include "../src/EntityManager.h"
+#include "../src/Vec2.h"
+#include "../src/Kernels.h"
+#include "../src/Memory.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Usage: EcsBenchmark [--config path] [--seed s] [--min n] [--max n]
+//                     [--isa scalar|sse2|avx2|neon] [--threads n]
+//
+// Runs every benchmark at entity counts min, 10*min, ... up to max and prints
+// one JSON object per line, e.g.
+//   {"bench":"movement","isa":"avx2","threads":8,"n":10000,"frames":1000,"ns_per_frame":...,
+//    "ns_per_entity":...,"allocs_per_frame":...,"bytes_per_frame":...}
+// Game worlds are drawn from the Game's own Random seeded with seed, and the
+// standalone benchmarks from srand(seed), so runs with the same seed repeat.
+// --threads sizes the Game's thread pool (0, the default, is one per core); the
+// churn, get_entities and vec2 benchmarks are single-threaded whatever it is.
+// Allocations are counted by the allocator in src/Memory.cpp, so they read
+// zero in a build with MEMORY_TRACKING=0.
+
+struct Options
+{
+    std::string config = "config.txt";
+    unsigned    seed = 1;
+    size_t      minN = 100;
+    size_t      maxN = 1000000;
+    size_t      threads = 0;
+};
+
+static size_t g_threads = 1;    // Game thread pool size, for the report
+
+struct Result
+{
+    std::string name;
+    size_t      n = 0;          // entities in the world
+    size_t      work = 0;       // entities touched per frame, the ns_per_entity divisor
+    size_t      frames = 0;
+    double      ns = 0;
+    size_t      allocs = 0;
+    size_t      bytes = 0;
+};
+
+void report(const Result & r)
+{
+    double perFrame = r.ns / r.frames;
+    std::cout << "{\"bench\":\"" << r.name << "\""
+              << ",\"isa\":\"" << Kernels::name(Kernels::active()) << "\""
+              << ",\"threads\":" << g_threads
+              << ",\"n\":" << r.n
+              << ",\"frames\":" << r.frames
+              << ",\"ns_per_frame\":" << perFrame
+              << ",\"ns_per_entity\":" << (r.work ? perFrame / r.work : 0.0)
+              << ",\"allocs_per_frame\":" << static_cast<double>(r.allocs) / r.frames
+              << ",\"bytes_per_frame\":" << static_cast<double>(r.bytes) / r.frames
+              << "}" << std::endl;
+}
+
+// Enough frames for a stable figure without letting 1M-entity runs take minutes
+size_t framesFor(size_t n)
+{
+    size_t frames = 10000000 / n;
+    return std::max<size_t>(5, std::min<size_t>(frames, 1000));
+}
+
+// Times 'frame' over 'frames' iterations. 'between' runs untimed before each
+// frame, for work such as EntityManager::update() that the benchmark excludes.
+template <typename Frame, typename Between>
+Result measure(const std::string & name, size_t n, size_t work, size_t frames,
+               Frame && frame, Between && between)
+{
+    Result r;
+    r.name = name;
+    r.n = n;
+    r.work = work;
+    r.frames = frames;
+    for (size_t f = 0; f < frames; f++)
+    {
+        between();
+
+        Memory::Counters before = Memory::counters();
+        auto t0 = std::chrono::steady_clock::now();
+
+        frame();
+
+        auto t1 = std::chrono::steady_clock::now();
+        Memory::Counters after = Memory::counters();
+        r.allocs += after.allocations - before.allocations;
+        r.bytes += after.bytes - before.bytes;
+        r.ns += std::chrono::duration<double, std::nano>(t1 - t0).count();
+    }
+    return r;
+}
+
+template <typename Frame>
+Result measure(const std::string & name, size_t n, size_t work, size_t frames, Frame && frame)
+{
+    return measure(name, n, work, frames, frame, [] {});
+}
+
+// Reaches into Game to run the real systems on a synthetic world
+struct GameBench
+{
+    // Fill the world with n entities (80% enemies, 20% bullets) at the same
+    // density as the default 1280x720 window with 500 entities, so collision
+    // work per entity stays comparable as n grows
+    static void populate(Game & g, size_t n, unsigned seed)
+    {
+        g.setSeed(seed);
+
+        float area = n * 1280.0f * 720.0f / 500.0f;
+        g.m_worldSize = Vec2(std::sqrt(area * 16.0f / 9.0f), std::sqrt(area * 9.0f / 16.0f));
+
+        // Keep bullets alive for the whole run so every frame sees the same load
+        g.m_bulletConfig.L = 1 << 30;
+        g.buildPrefabs();
+
+        g.m_entities.clear();
+        g.spawnPlayer();
+
+        size_t bullets = n / 5;
+        g.spawnEnemyWave(n - bullets - 1);
+
+        ComponentStore& c = g.m_entities.components();
+        for (size_t i = 0; i < bullets; i++)
+        {
+            Vec2 target(g.m_rng.range(-500.0f, 500.0f), g.m_rng.range(-500.0f, 500.0f));
+            g.spawnBullet(g.m_player, c.pos(g.m_entities.row(g.m_player)) + target);
+        }
+        g.applyCommands();
+
+        // Scatter the bullets, the last rows, instead of stacking them on the player
+        for (size_t row = c.size() - bullets; row < c.size(); row++)
+        {
+            c.setPos(row, Vec2(g.m_rng.range(0.0f, g.m_worldSize.x),
+                               g.m_rng.range(0.0f, g.m_worldSize.y)));
+        }
+
+        g.m_entities.update();
+    }
+
+    static void threads(Game & g, size_t threads)
+    {
+        g.m_pool.start(threads);
+        g_threads = g.m_pool.size();
+    }
+
+    static void run(Game & g, const Options & opt, size_t n)
+    {
+        size_t frames = framesFor(n);
+
+        populate(g, n, opt.seed);
+        report(measure("movement", n, n, frames, [&] { g.sMovement(); }));
+
+        populate(g, n, opt.seed);
+        report(measure("lifespan", n, n, frames, [&] { g.sLifespan(); }));
+
+        // Collisions record destroys and small-enemy spawns; play those back
+        // and fold them in between frames, outside the timed region
+        populate(g, n, opt.seed);
+        report(measure("collision", n, n, frames,
+                       [&] { g.sCollision(); },
+                       [&] { g.applyCommands(); g.m_entities.update(); }));
+
+        // Spatial queries: the 8 enemies nearest to, and every enemy within
+        // 100 px of, 64 points a frame. The index is rebuilt between frames,
+        // untimed, as movement would force it to be.
+        populate(g, n, opt.seed);
+        EntityVec found;
+        found.reserve(n);
+        auto queries = [&]
+        {
+            for (int q = 0; q < 64; q++)
+            {
+                Vec2 p(g.m_rng.range(0.0f, g.m_worldSize.x), g.m_rng.range(0.0f, g.m_worldSize.y));
+                g.m_entities.nearest(p, g.m_enemyTag, 8, found);
+                g.m_entities.queryRadius(p, 100.0f, g.m_enemyTag, found);
+            }
+        };
+        auto rebuild = [&]
+        {
+            g.m_entities.positionsChanged();
+            g.m_entities.nearest(Vec2(), g.m_enemyTag, 1, found);
+        };
+        queries();
+        report(measure("spatial_query", n, 128, frames, queries, rebuild));
+
+        // Spawn path: a 64-bullet special weapon per frame into a world that
+        // recycles last frame's bullets. After warm-up the pools should
+        // serve every spawn, i.e. zero allocations per frame.
+        populate(g, n, opt.seed);
+        auto recycleBullets = [&]
+        {
+            for (Entity b : g.m_entities.getEntities(g.m_bulletTag))
+            {
+                g.m_entities.destroy(b);
+            }
+            g.m_entities.update();
+        };
+        auto spawn = [&]
+        {
+            g.spawnSpecialWeapon(g.m_player);
+            g.applyCommands();
+        };
+        for (int i = 0; i < 3; i++)
+        {
+            spawn();
+            recycleBullets();
+        }
+        report(measure("spawn", n, 64, frames, spawn, recycleBullets));
+    }
+};
+
+// addEntity + update() with a tenth of the world replaced every frame
+void benchChurn(const Options & opt, size_t n)
+{
+    std::srand(opt.seed);
+    EntityManager mgr;
+    for (size_t i = 0; i < n; i++)
+    {
+        Entity e = mgr.addEntity(i % 5 ? "enemy" : "bullet");
+        mgr.addComponent(e, CTransform(Vec2(std::rand() % 1280, std::rand() % 720), Vec2(1, 1), 0.0f));
+    }
+    mgr.update();
+
+    size_t churn = std::max<size_t>(1, n / 10);
+    report(measure("churn", n, churn, framesFor(n), [&]
+    {
+        const EntityVec& entities = mgr.getEntities();
+        for (size_t i = 0; i < churn; i++)
+        {
+            mgr.destroy(entities[i]);
+        }
+        for (size_t i = 0; i < churn; i++)
+        {
+            Entity e = mgr.addEntity(i % 5 ? "enemy" : "bullet");
+            mgr.addComponent(e, CTransform(Vec2(std::rand() % 1280, std::rand() % 720), Vec2(1, 1), 0.0f));
+        }
+        mgr.update();
+    }));
+}
+
+// getEntities(tag) followed by the walk every system does over the result
+void benchGetEntities(const Options &, size_t n)
+{
+    EntityManager mgr;
+    for (size_t i = 0; i < n; i++)
+    {
+        mgr.addEntity(i % 5 ? "enemy" : "bullet");
+    }
+    mgr.update();
+
+    size_t sum = 0;
+    size_t enemies = mgr.getEntities("enemy").size();
+    report(measure("get_entities", n, enemies, framesFor(n), [&]
+    {
+        for (Entity e : mgr.getEntities("enemy"))
+        {
+            sum += mgr.row(e);
+        }
+    }));
+
+    // Keep the loop from being optimised away
+    if (sum == 1)
+    {
+        std::cerr << sum;
+    }
+}
+
+void benchVec2(const Options & opt, size_t n)
+{
+    std::srand(opt.seed);
+    std::vector<Vec2> a(n), b(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        a[i] = Vec2(std::rand() % 1280, std::rand() % 720);
+        b[i] = Vec2(std::rand() % 7 - 3.0f, std::rand() % 7 - 3.0f);
+    }
+
+    float sum = 0;
+    report(measure("vec2", n, n, framesFor(n), [&]
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            Vec2 v = b[i] * 0.5f;
+            a[i] -= v;
+            sum += a[i].distSq(b[i]);
+            v.normalize();
+            a[i] += v;
+        }
+    }));
+
+    if (sum == 1.0f)
+    {
+        std::cerr << sum;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options opt;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        if (arg == "--config") opt.config = argv[i + 1];
+        else if (arg == "--seed") opt.seed = std::atoi(argv[i + 1]);
+        else if (arg == "--min") opt.minN = std::atol(argv[i + 1]);
+        else if (arg == "--max") opt.maxN = std::atol(argv[i + 1]);
+        else if (arg == "--threads") opt.threads = std::atol(argv[i + 1]);
+        else if (arg == "--isa")
+        {
+            // Force a kernel implementation to compare it against the others
+            std::string isa = argv[i + 1];
+            for (Kernels::Isa k : { Kernels::Isa::Scalar, Kernels::Isa::SSE2, Kernels::Isa::AVX2, Kernels::Isa::NEON })
+            {
+                if (isa == Kernels::name(k) && !Kernels::use(k))
+                {
+                    std::cerr << "isa not supported: " << isa << "\n";
+                    return 1;
+                }
+            }
+        }
+    }
+
+    Game g(opt.config, true);
+    GameBench::threads(g, opt.threads);
+    for (size_t n = opt.minN; n <= opt.maxN; n *= 10)
+    {
+        benchChurn(opt, n);
+        benchGetEntities(opt, n);
+        benchVec2(opt, n);
+        GameBench::run(g, opt, n);
+    }
+
+    return 0;
+}
@@ -1,40 +1,232 @@
 #include "../src/Entity.h"
 #include "../src/EntityManager.h"
+#include "../src/CommandBuffer.h"
+#include "../src/Prefab.h"
 #include "../src/Component.h"
 #include <iostream>
+#include <algorithm>
+#include <cstdlib>
 
 int main()
 {
     EntityManager MGR;
     
-    std::shared_ptr<Entity> e = MGR.addEntity("ass");
+    Entity e = MGR.addEntity("ass");
 
-    std::cout << "Entity tag: " << e->tag() << std::endl;
+    std::cout << "Entity tag: " << MGR.tag(e) << std::endl;
 
-    std::cout << "Active: " << e->isActive() << std::endl;
+    std::cout << "Active: " << MGR.isActive(e) << std::endl;
 
-    // e.cShape is currently just a nullptt
-    if (e->cShape)
+    // the entity owns a row in the component store, but no components yet
+    ComponentStore& c = MGR.components();
+    if (c.has(MGR.row(e), Components::Shape))
     {
-        std::cout << "CShape: " << e->cShape->circle.getOrigin().x << std::endl;
+        std::cout << "CShape: " << c.shape[MGR.row(e)].circle.getOrigin().x << std::endl;
     } else
     {
-        std::cout << "CShape is nullptr" << std::endl;
+        std::cout << "CShape is missing" << std::endl;
     }
     
     // Properly initialize the shape component to the entity
-    e->cShape = std::make_shared<CShape>(2.0f, 3, sf::Color(0,0,0),
-                                         sf::Color(255,255,255), 1.0f);
+    MGR.addComponent(e, CShape(2.0f, 3, sf::Color(0,0,0),
+                               sf::Color(255,255,255), 1.0f));
     
-    // e.cShape is no longer a nullptr
-    if (e->cShape)
+    // the shape bit is now set
+    if (c.has(MGR.row(e), Components::Shape))
     {
-        std::cout << "CShape X: " << e->cShape->circle.getOrigin().x << std::endl;
+        std::cout << "CShape X: " << c.shape[MGR.row(e)].circle.getOrigin().x << std::endl;
     } else
     {
-        std::cout << "CShape is nullptr";
+        std::cout << "CShape is missing";
     }
-    
+
+    // Dead entities are removed on update and the surviving rows are packed
+    Entity a = MGR.addEntity("a");
+    Entity b = MGR.addEntity("b");
+    MGR.addComponent(b, CCollision(7.0f));
+    MGR.update();
+    MGR.destroy(a);
+    MGR.update();
+    std::cout << "Rows after removal (expect 2): " << c.size() << std::endl;
+    std::cout << "Row of b (expect 1): " << MGR.row(b) << std::endl;
+    std::cout << "b collision radius (expect 7): " << c.collisionRadius[MGR.row(b)] << std::endl;
+
+    // The removed entity's slot is recycled under a new generation
+    Entity reused = MGR.addEntity("a");
+    std::cout << "Slot reused (expect 1): " << (reused.slot() == a.slot()) << std::endl;
+    std::cout << "Stale handle valid (expect 0): " << MGR.isValid(a) << std::endl;
+    std::cout << "New handle valid (expect 1): " << MGR.isValid(reused) << std::endl;
+
+    // Tags are interned once; per-tag lists only hold committed entities
+    std::cout << "Same tag, same id (expect 1): " << (MGR.tagId("a") == MGR.tagOf(reused)) << std::endl;
+    std::cout << "Tag name round trip (expect b): " << MGR.tagName(MGR.tagOf(b)) << std::endl;
+    std::cout << "Pending not listed (expect 0): " << MGR.getEntities("a").size() << std::endl;
+    MGR.update();
+    std::cout << "Committed and listed (expect 1): " << MGR.getEntities("a").size() << std::endl;
+    std::cout << "Unknown tag is empty (expect 0): " << MGR.getEntities("nobody").size() << std::endl;
+
+    // A view visits only live entities holding every requested component
+    Entity moving = MGR.addEntity("a");
+    Entity dead = MGR.addEntity("a");
+    MGR.addComponent(moving, CTransform(Vec2(1, 2), Vec2(0, 0), 0.0f));
+    MGR.addComponent(dead, CTransform(Vec2(3, 4), Vec2(0, 0), 0.0f));
+    MGR.update();
+    MGR.destroy(dead);
+    int visited = 0;
+    MGR.view<CTransform>([&](Entity, TransformRef t)
+    {
+        visited++;
+        t.x += 10.0f;
+    });
+    std::cout << "Transform view visits (expect 1): " << visited << std::endl;
+    std::cout << "Written through the view (expect 11): " << c.posX[MGR.row(moving)] << std::endl;
+    visited = 0;
+    MGR.view<CTransform, CCollision>(MGR.tagId("b"), [&](Entity, TransformRef, CollisionRef) { visited++; });
+    std::cout << "Tagged view needing a transform (expect 0): " << visited << std::endl;
+    visited = 0;
+    MGR.view<CTransform>(MGR.tagId("a"), [&](Entity, TransformRef)
+    {
+        // Interning grows the tag lists under the view
+        for (int i = 0; i < 64; i++)
+        {
+            MGR.tagId("interned in a view " + std::to_string(i));
+        }
+        visited++;
+    });
+    std::cout << "Tagged view interning tags visits (expect 1): " << visited << std::endl;
+
+    // Lifespans start counting once committed and expire on the tick they run
+    // out on, however long they are; removed entities are taken off the wheel
+    Entity brief = MGR.addEntity("b");
+    Entity longLived = MGR.addEntity("b");
+    Entity killed = MGR.addEntity("b");
+    MGR.addComponent(brief, CLifespan(3));
+    MGR.addComponent(longLived, CLifespan(70000));
+    MGR.addComponent(killed, CLifespan(5));
+    MGR.update();
+    MGR.destroy(killed);
+    MGR.update();
+    EntityVec expired;
+    int briefTick = 0, longTick = 0, otherExpiries = 0;
+    for (int tick = 0; tick <= 70000; tick++)
+    {
+        expired.clear();
+        MGR.expireLifespans(expired);
+        for (Entity x : expired)
+        {
+            if (x == brief) briefTick = tick;
+            else if (x == longLived) longTick = tick;
+            else otherExpiries++;
+        }
+    }
+    std::cout << "Short lifespan expires on tick (expect 3): " << briefTick << std::endl;
+    std::cout << "Long lifespan expires on tick (expect 70000): " << longTick << std::endl;
+    std::cout << "Removed entity never expires (expect 0): " << otherExpiries << std::endl;
+
+    // Recorded commands change nothing until playback
+    CommandBuffer commands;
+    size_t rowsBefore = c.size();
+    CommandBuffer::Spawn spawned = commands.spawn(MGR.tagId("b"));
+    commands.add(spawned, CCollision(3.0f));
+    commands.destroy(longLived);
+    std::cout << "Rows unchanged while recording (expect 1): " << (c.size() == rowsBefore) << std::endl;
+    std::cout << "Still active while recording (expect 1): " << MGR.isActive(longLived) << std::endl;
+    commands.playback(MGR);
+    std::cout << "Spawned on playback (expect 1): " << (c.size() == rowsBefore + 1) << std::endl;
+    std::cout << "Spawn's collision radius (expect 3): " << c.collisionRadius[c.size() - 1] << std::endl;
+    std::cout << "Destroyed on playback (expect 0): " << MGR.isActive(longLived) << std::endl;
+    std::cout << "Buffer empty after playback (expect 1): " << commands.empty() << std::endl;
+
+    // Instances of a prefab copy all of its components and can override any
+    // of them; their lifespans start counting once committed
+    Prefab spark(MGR.tagId("b"));
+    spark.add(CTransform(Vec2(0, 0), Vec2(1, 2), 0.0f, 4.0f));
+    spark.addShape().set(5.0f, 6, sf::Color(10, 20, 30), sf::Color(40, 50, 60), 1.0f);
+    spark.add(CCollision(5.0f));
+    spark.add(CLifespan(2));
+    Entity plain = MGR.instantiate(spark);
+    Entity moved = MGR.instantiate(spark);
+    MGR.addComponent(moved, CTransform(Vec2(100, 100), Vec2(0, 0), 0.0f));
+    c.shape[MGR.row(moved)].circle.setFillColor(sf::Color(255, 0, 0));
+    CommandBuffer::Spawn buffered = commands.spawn(spark);
+    commands.add(buffered, CommandBuffer::Fill{ sf::Color(0, 255, 0) });
+    commands.playback(MGR);
+    std::cout << "Buffered instance fill green (expect 255): "
+              << static_cast<int>(c.shape[c.size() - 1].circle.getFillColor().g) << std::endl;
+    MGR.update();
+    size_t plainRow = MGR.row(plain), movedRow = MGR.row(moved);
+    std::cout << "Instance tag (expect b): " << MGR.tag(plain) << std::endl;
+    std::cout << "Instance points and radius (expect 6 5): " << c.shape[plainRow].circle.getPointCount()
+              << " " << c.shape[plainRow].circle.getRadius() << std::endl;
+    std::cout << "Instance spin and collision radius (expect 4 5): " << c.spin[plainRow] << " " << c.collisionRadius[plainRow] << std::endl;
+    std::cout << "Overridden x and fill red (expect 100 255): " << c.posX[movedRow]
+              << " " << static_cast<int>(c.shape[movedRow].circle.getFillColor().r) << std::endl;
+    std::cout << "Prefab unchanged (expect 10): " << static_cast<int>(spark.components().shape[0].circle.getFillColor().r) << std::endl;
+    int sparkExpiries = 0;
+    for (int tick = 0; tick <= 2; tick++)
+    {
+        expired.clear();
+        MGR.expireLifespans(expired);
+        sparkExpiries += static_cast<int>(tick == 2 ? expired.size() : 10 * expired.size());
+    }
+    std::cout << "Instances all expire on tick 2 (expect 3): " << sparkExpiries << std::endl;
+
+    // Spatial queries find what a scan of the tag finds, skipping other tags
+    // and destroyed entities, and see positions changed since the last query
+    EntityManager world;
+    world.setQueryCellSize(40.0f);
+    TagId foe = world.tagId("enemy");
+    std::srand(7);
+    for (int i = 0; i < 1000; i++)
+    {
+        Entity x = world.addEntity(i % 4 ? "enemy" : "bullet");
+        world.addComponent(x, CTransform(Vec2(std::rand() % 1280, std::rand() % 720), Vec2(0, 0), 0.0f));
+    }
+    world.update();
+    world.destroy(world.getEntities(foe)[0]);
+
+    ComponentStore& wc = world.components();
+    EntityVec found, scanned;
+    int radiusMismatches = 0, nearestMismatches = 0;
+    for (int q = 0; q < 200; q++)
+    {
+        Vec2 p(std::rand() % 1280, std::rand() % 720);
+        float r = static_cast<float>(std::rand() % 150);
+        scanned.clear();
+        for (Entity x : world.getEntities(foe))
+        {
+            if (world.isActive(x) && p.distSq(wc.pos(world.row(x))) <= r * r) scanned.push_back(x);
+        }
+        world.queryRadius(p, r, foe, found);
+        auto byId = [](Entity a, Entity b) { return a.id() < b.id(); };
+        std::sort(found.begin(), found.end(), byId);
+        std::sort(scanned.begin(), scanned.end(), byId);
+        if (found != scanned) radiusMismatches++;
+
+        // The k-th nearest must be no farther than any entity left out
+        world.nearest(p, foe, 5, found);
+        float kth = p.distSq(wc.pos(world.row(found.back())));
+        for (Entity x : world.getEntities(foe))
+        {
+            bool listed = std::find(found.begin(), found.end(), x) != found.end();
+            if (world.isActive(x) && !listed && p.distSq(wc.pos(world.row(x))) < kth) nearestMismatches++;
+        }
+        if (found.size() != 5) nearestMismatches++;
+    }
+    std::cout << "Radius query mismatches vs scan (expect 0): " << radiusMismatches << std::endl;
+    std::cout << "Nearest mismatches vs scan (expect 0): " << nearestMismatches << std::endl;
+
+    Entity mover = world.getEntities(foe)[1];
+    wc.setPos(world.row(mover), Vec2(5000, 5000));
+    world.positionsChanged();
+    world.nearest(Vec2(5001, 5001), foe, 1, found);
+    std::cout << "Nearest sees the move (expect 1): " << (found.size() == 1 && found[0] == mover) << std::endl;
+
+    // Clearing the manager invalidates every outstanding handle
+    MGR.clear();
+    std::cout << "After clear, e/b/reused valid (expect 000): "
+              << MGR.isValid(e) << MGR.isValid(b) << MGR.isValid(reused) << std::endl;
+    std::cout << "Entities after clear (expect 0): " << MGR.getEntities().size() << std::endl;
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,211 @@
+#include "../src/Game.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+
+// config.txt without the window and font, which a headless game skips
+const char* CONFIG =
+    "Player 32 32 5 0 0 0 255 0 0 4 8\n"
+    "Enemy 32 32 3 6 0 0 0 0 3 8 90 60\n"
+    "Bullet 10 10 20 255 255 255 255 255 255 2 20 90\n"
+    "Simulation 60 5\n";
+
+// Offsets of Header fields in Snapshot.cpp
+const size_t ENTITIES_OFFSET = 16;
+const size_t TAGS_OFFSET = 20;
+const size_t PLAYER_ROW_OFFSET = 24;
+
+std::string readFile(const std::string & path)
+{
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream bytes;
+    bytes << in.rdbuf();
+    return bytes.str();
+}
+
+void writeFile(const std::string & path, const std::string & bytes)
+{
+    std::ofstream out(path, std::ios::binary);
+    out.write(bytes.data(), bytes.size());
+}
+
+void setField(std::string & bytes, size_t offset, uint32_t value)
+{
+    std::memcpy(&bytes[offset], &value, sizeof value);
+}
+
+uint32_t field(const std::string & bytes, size_t offset)
+{
+    uint32_t value;
+    std::memcpy(&value, &bytes[offset], sizeof value);
+    return value;
+}
+
+void runTicks(Game & g, int ticks)
+{
+    for (int i = 0; i < ticks; i++)
+    {
+        g.step();
+    }
+}
+
+int main()
+{
+    std::istringstream configA(CONFIG);
+    Game a(configA, 1);
+    a.setSeed(7);
+    runTicks(a, 3000);
+    a.saveSnapshot("headless_a.bin");
+    std::string saved = readFile("headless_a.bin");
+
+    // Saving a loaded world writes the same bytes, and it runs on exactly as
+    // the world it was saved from would have
+    std::istringstream configB(CONFIG);
+    Game b(configB, 1);
+    bool loaded = b.loadSnapshot("headless_a.bin");
+    std::cout << "Snapshot loads (expect 1): " << loaded << std::endl;
+    b.saveSnapshot("headless_b.bin");
+    std::cout << "Save, load, save is identical (expect 1): " << (readFile("headless_b.bin") == saved) << std::endl;
+
+    runTicks(b, 500);
+    b.saveSnapshot("headless_b.bin");
+    std::istringstream configFresh(CONFIG);
+    Game fresh(configFresh, 1);
+    fresh.setSeed(7);
+    runTicks(fresh, 3500);
+    fresh.saveSnapshot("headless_fresh.bin");
+    std::cout << "Load and 500 ticks matches 3500 ticks (expect 1): "
+              << (readFile("headless_b.bin") == readFile("headless_fresh.bin")) << std::endl;
+
+    // A rejected file leaves the world as it was, without even interning the
+    // tag names it held
+    std::string bad = saved.substr(0, saved.size() / 2);
+    size_t name = saved.find("bullet");
+    bad[name] = 'X';
+    writeFile("headless_bad.bin", bad);
+    loaded = b.loadSnapshot("headless_bad.bin");
+    std::cout << "Truncated snapshot loads (expect 0): " << loaded << std::endl;
+    b.saveSnapshot("headless_after.bin");
+    std::cout << "World unchanged by a bad file (expect 1): "
+              << (readFile("headless_after.bin") == readFile("headless_b.bin")) << std::endl;
+
+    bad = saved;
+    setField(bad, TAGS_OFFSET, 0xFFFFFFFFu);
+    writeFile("headless_bad.bin", bad);
+    loaded = b.loadSnapshot("headless_bad.bin");
+    std::cout << "Huge tag count loads (expect 0): " << loaded << std::endl;
+
+    bad = saved;
+    setField(bad, ENTITIES_OFFSET, 0x7FFFFFFFu);
+    writeFile("headless_bad.bin", bad);
+    loaded = b.loadSnapshot("headless_bad.bin");
+    std::cout << "Huge entity count loads (expect 0): " << loaded << std::endl;
+
+    bad = saved;
+    setField(bad, PLAYER_ROW_OFFSET, (field(saved, PLAYER_ROW_OFFSET) + 1) % field(saved, ENTITIES_OFFSET));
+    writeFile("headless_bad.bin", bad);
+    loaded = b.loadSnapshot("headless_bad.bin");
+    std::cout << "Player row on another tag loads (expect 0): " << loaded << std::endl;
+
+    // Random damage past the magic: loads either fail cleanly or give a world
+    // that keeps running
+    std::mt19937 rng(1);
+    int survived = 0;
+    for (int run = 0; run < 300; run++)
+    {
+        bad = saved;
+        for (int flip = 0; flip < 3; flip++)
+        {
+            size_t at = 4 + rng() % (bad.size() - 4);
+            bad[at] = static_cast<char>(bad[at] ^ (1 << (rng() % 8)));
+        }
+        writeFile("headless_bad.bin", bad);
+        if (b.loadSnapshot("headless_bad.bin"))
+        {
+            runTicks(b, 50);
+        }
+        survived++;
+    }
+    std::cout << "Damaged snapshots survived (expect 300): " << survived << std::endl;
+
+    // A log of moves and clicks for a fresh game seeded with 7
+    Random seeded(7);
+    InputLogStart start;
+    start.seed = 7;
+    start.rngState = seeded.state();
+    start.rngIncrement = seeded.increment();
+    InputRecorder script;
+    script.open("headless_script.log", start);
+    TickInput input;
+    for (int i = 0; i < 600; i++)
+    {
+        input.clear();
+        input.keys = static_cast<uint8_t>((i / 50) % 16);
+        if (i % 37 == 0)
+        {
+            input.clicks.push_back({ TickInput::Fire, static_cast<int16_t>(i * 7 % 1280), static_cast<int16_t>(i * 3 % 720) });
+        }
+        if (i % 200 == 199)
+        {
+            input.clicks.push_back({ TickInput::Special, 0, 0 });
+        }
+        script.write(input);
+    }
+    script.close();
+
+    // Recording while replaying, then replaying the recording, ends in the
+    // same world. A log is complete once its game is gone.
+    {
+        std::istringstream configR(CONFIG);
+        Game recorded(configR, 1);
+        recorded.replay("headless_script.log");
+        recorded.record("headless_a.log");
+        runTicks(recorded, 600);
+        recorded.saveSnapshot("headless_a.bin");
+    }
+    std::istringstream configP(CONFIG);
+    Game replayed(configP, 1);
+    loaded = replayed.replay("headless_a.log");
+    std::cout << "Recorded log replays (expect 1): " << loaded << std::endl;
+    runTicks(replayed, 600);
+    replayed.saveSnapshot("headless_b.bin");
+    std::cout << "Record then replay is identical (expect 1): "
+              << (readFile("headless_a.bin") == readFile("headless_b.bin")) << std::endl;
+
+    // A log recorded after a load replays on that snapshot, and only there
+    {
+        std::istringstream configL(CONFIG);
+        Game later(configL, 1);
+        later.replay("headless_script.log");
+        runTicks(later, 300);
+        later.saveSnapshot("headless_start.bin");
+        later.record("headless_b.log");
+        runTicks(later, 300);
+        later.saveSnapshot("headless_a.bin");
+    }
+    std::istringstream configS(CONFIG);
+    Game resumed(configS, 1);
+    resumed.loadSnapshot("headless_start.bin");
+    loaded = resumed.replay("headless_b.log");
+    std::cout << "Log replays on its snapshot (expect 1): " << loaded << std::endl;
+    runTicks(resumed, 300);
+    resumed.saveSnapshot("headless_b.bin");
+    std::cout << "Replay from a snapshot is identical (expect 1): "
+              << (readFile("headless_a.bin") == readFile("headless_b.bin")) << std::endl;
+    loaded = fresh.replay("headless_b.log");
+    std::cout << "Log replays on another world (expect 0): " << loaded << std::endl;
+
+    std::remove("headless_a.bin");
+    std::remove("headless_b.bin");
+    std::remove("headless_fresh.bin");
+    std::remove("headless_bad.bin");
+    std::remove("headless_after.bin");
+    std::remove("headless_start.bin");
+    std::remove("headless_script.log");
+    std::remove("headless_a.log");
+    std::remove("headless_b.log");
+}
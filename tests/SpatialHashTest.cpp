@@ -0,0 +1,58 @@
+#include "../src/SpatialHash.h"
+#include <iostream>
+#include <cstdlib>
+
+int main()
+{
+    // Scatter points over a 1280x720 field, some of them off-screen
+    std::srand(42);
+    std::vector<Vec2> points;
+    for (int i = 0; i < 2000; i++)
+    {
+        points.push_back(Vec2(std::rand() % 1600 - 160, std::rand() % 1000 - 140));
+    }
+
+    SpatialHash grid;
+    grid.clear(42.0f);
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        grid.insert(i, points[i]);
+    }
+    grid.build();
+
+    std::cout << "Spatial Hash Test\n-------------------\n";
+    std::cout << "Items in grid: " << grid.size() << "\n";
+
+    // Every radius query must find exactly the points a brute-force scan finds
+    int mismatches = 0;
+    for (int q = 0; q < 500; q++)
+    {
+        Vec2 center(std::rand() % 1280, std::rand() % 720);
+        float radius = static_cast<float>(std::rand() % 80);
+
+        size_t bruteCount = 0;
+        for (auto& p : points)
+        {
+            if (center.distSq(p) <= radius * radius) bruteCount++;
+        }
+
+        size_t gridCount = 0;
+        grid.query(center, radius, [&](size_t i)
+        {
+            if (center.distSq(points[i]) <= radius * radius) gridCount++;
+        });
+
+        if (bruteCount != gridCount) mismatches++;
+    }
+    std::cout << "Query mismatches vs brute force (expect 0): " << mismatches << "\n";
+
+    // An empty grid never calls back
+    SpatialHash empty;
+    empty.clear(10.0f);
+    empty.build();
+    int calls = 0;
+    empty.query(Vec2(0, 0), 100.0f, [&](size_t) { calls++; });
+    std::cout << "Empty grid callbacks (expect 0): " << calls << "\n";
+
+    return 0;
+}
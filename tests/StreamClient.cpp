@@ -0,0 +1,222 @@
+#include "../src/WorldStream.h"
+#include "../src/Entity.h"
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <map>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// StreamClient                                  encoder/decoder round trip
+// StreamClient socket [frames] [--record file]  watch a game run with --stream
+//
+// Watching prints each tag's entity count once a second of ticks and a
+// summary at the end; --record writes the raw stream, header included, so it
+// can be decoded again later.
+
+static bool readAll(int fd, uint8_t* data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t n = ::recv(fd, data, size, 0);
+        if (n <= 0)
+        {
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+static bool same(const StreamEntity & a, const StreamEntity & b)
+{
+    return a.id == b.id && a.tag == b.tag && a.x == b.x && a.y == b.y && a.angle == b.angle
+        && std::memcmp(a.rgba, b.rgba, 4) == 0;
+}
+
+static int roundTrip()
+{
+    std::cout << "Stream Round Trip\n-------------------\n";
+
+    // Random worlds that keep most entities from frame to frame, move some,
+    // fade some, and reuse slots with new generations
+    StreamEncoder encoder;
+    StreamDecoder decoder;
+    encoder.setTags({ "player", "bullet", "enemy" });
+    std::map<uint32_t, StreamEntity> world;    // by slot
+    std::vector<uint8_t> bytes;
+    size_t keyBytes = 0, deltaBytes = 0, mismatches = 0, failures = 0;
+    std::srand(7);
+    for (uint32_t tick = 0; tick < 500; tick++)
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            uint32_t slot = std::rand() % 300;
+            auto it = world.find(slot);
+            if (it != world.end() && std::rand() % 2)
+            {
+                world.erase(it);
+                continue;
+            }
+            StreamEntity e;
+            e.id = slot | (tick + 1) << 22;
+            e.tag = static_cast<uint16_t>(std::rand() % 3);
+            e.x = std::rand() % 20000;
+            e.y = std::rand() % 20000;
+            e.angle = static_cast<uint16_t>(std::rand());
+            e.rgba[0] = 255;
+            e.rgba[3] = 255;
+            world[slot] = e;
+        }
+        for (auto& kv : world)
+        {
+            StreamEntity& e = kv.second;
+            e.x += std::rand() % 61 - 30;
+            e.y -= std::rand() % 61 - 30;
+            e.angle = static_cast<uint16_t>(e.angle + 700);
+            if (std::rand() % 10 == 0) e.rgba[3]--;
+        }
+
+        StreamFrame frame;
+        frame.tick = tick;
+        for (auto& kv : world)
+        {
+            frame.entities.push_back(kv.second);
+        }
+        if (tick == 250)
+        {
+            encoder.reset();    // as for a new spectator
+        }
+        encoder.encode(frame, bytes);
+        (tick == 0 || tick == 250 ? keyBytes : deltaBytes) += bytes.size();
+        if (!decoder.decode(bytes.data() + 4, bytes.size() - 4))
+        {
+            failures++;
+        }
+
+        const std::vector<StreamEntity>& decoded = decoder.entities();
+        if (decoded.size() != world.size() || decoder.tick() != tick)
+        {
+            mismatches++;
+            continue;
+        }
+        for (const StreamEntity& e : decoded)
+        {
+            auto it = world.find(e.id & (Entity::MAX_SLOTS - 1));
+            if (it == world.end() || !same(it->second, e)) mismatches++;
+        }
+    }
+    std::cout << "Decode failures (expect 0): " << failures << "\n";
+    std::cout << "Mismatched frames or entities (expect 0): " << mismatches << "\n";
+    std::cout << "Tag 2 name (expect enemy): " << decoder.tagName(2) << "\n";
+    std::cout << "Key frame bytes: " << keyBytes / 2 << ", delta frame bytes: " << deltaBytes / 498
+              << " (" << world.size() << " entities, 18 bytes each raw)\n";
+
+    // A delta with no key frame before it is refused
+    StreamDecoder fresh;
+    std::cout << "Delta before key frame (expect 0): " << fresh.decode(bytes.data() + 4, bytes.size() - 4) << "\n";
+    return failures || mismatches;
+}
+
+static int watch(const std::string & path, long frames, const std::string & record)
+{
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof addr.sun_path - 1);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) != 0)
+    {
+        std::cout << "could not connect to " << path << "\n";
+        return 1;
+    }
+
+    std::ofstream out;
+    if (!record.empty())
+    {
+        out.open(record, std::ios::binary);
+    }
+
+    uint8_t header[8];
+    if (!readAll(fd, header, sizeof header) || !StreamDecoder::header(header, sizeof header))
+    {
+        std::cout << "not a world stream\n";
+        return 1;
+    }
+    out.write(reinterpret_cast<char*>(header), sizeof header);
+
+    StreamDecoder decoder;
+    std::vector<uint8_t> body;
+    size_t received = 0, bytes = sizeof header, skipped = 0;
+    uint32_t last = 0;
+    while (frames < 0 || static_cast<long>(received) < frames)
+    {
+        uint8_t length[4];
+        if (!readAll(fd, length, 4))
+        {
+            break;
+        }
+        uint32_t size = length[0] | length[1] << 8 | length[2] << 16 | static_cast<uint32_t>(length[3]) << 24;
+        body.resize(size);
+        if (!readAll(fd, body.data(), size) || !decoder.decode(body.data(), size))
+        {
+            std::cout << "bad frame\n";
+            return 1;
+        }
+        out.write(reinterpret_cast<char*>(length), 4);
+        out.write(reinterpret_cast<char*>(body.data()), size);
+
+        // Ticks the sender dropped show up as gaps
+        if (received > 0 && decoder.tick() > last + 1)
+        {
+            skipped += decoder.tick() - last - 1;
+        }
+        last = decoder.tick();
+        received++;
+        bytes += 4 + size;
+
+        if (decoder.tick() % 60 == 0)
+        {
+            std::map<std::string, size_t> counts;
+            for (const StreamEntity& e : decoder.entities())
+            {
+                counts[decoder.tagName(e.tag)]++;
+            }
+            std::cout << "tick " << decoder.tick() << ":";
+            for (auto& kv : counts)
+            {
+                std::cout << " " << kv.first << " " << kv.second;
+            }
+            std::cout << "\n";
+        }
+    }
+    ::close(fd);
+
+    std::cout << "frames:  " << received << "\n";
+    std::cout << "skipped: " << skipped << "\n";
+    std::cout << "bytes:   " << bytes << " (" << (received ? bytes / received : 0) << " per frame)\n";
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        return roundTrip();
+    }
+
+    long frames = -1;
+    std::string record;
+    for (int i = 2; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--record" && i + 1 < argc) record = argv[++i];
+        else frames = std::atol(argv[i]);
+    }
+    return watch(argv[1], frames, record);
+}